@@ -11,3 +11,9 @@ USE_LPCOPEN=y
 USE_FATFS=y
 USE_FREERTOS=y
 FREERTOS_HEAP_TYPE=1
+
+# CMSIS-DSP, solo lo usa spectrum.c.  Con SPECTRUM_USED=1 se compila el
+# espectro y se puede usar APP_PROC_FFT; hay que agregar ademas la biblioteca
+# arm_cortexM4lf_math al linkeo.
+DEFINES+=ARM_MATH_CM4
+DEFINES+=SPECTRUM_USED=0
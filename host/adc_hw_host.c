@@ -0,0 +1,71 @@
+#include <stddef.h>
+
+#include "adc.h"
+#include "adc_hw_host.h"
+
+
+adc_hw_host host_dma;
+uint32_t    host_time_us;
+
+void DMA_IRQHandler( void );
+
+
+int adc_hw_dma_setup( uint8_t mask )
+{
+    (void) mask;
+    return host_dma.fail_setup ? -1 : 0;
+}
+
+int adc_hw_dma_setup_dual( int chn0, int chn1 )
+{
+    (void) chn0;
+    (void) chn1;
+    return host_dma.fail_setup ? -1 : 0;
+}
+
+void adc_hw_dma_transfer( uint8_t* dst, unsigned n )
+{
+    host_dma.dst = dst;
+    host_dma.n   = n;
+    host_dma.transfers++;
+}
+
+void adc_hw_dma_restart( uint8_t* dst, unsigned n )
+{
+    host_dma.restarts++;
+    adc_hw_dma_transfer(dst, n);
+}
+
+void adc_hw_dma_stop( void )
+{
+    host_dma.dst = NULL;
+    host_dma.stops++;
+}
+
+bool adc_hw_dma_ack( void )
+{
+    return true;
+}
+
+bool adc_hw_dma_aligned( void )
+{
+    const bool aligned = !host_dma.misaligned;
+    host_dma.misaligned = false;
+    return aligned;
+}
+
+bool adc_hw_host_complete( void )
+{
+    uint8_t* dst = host_dma.dst;
+    if (dst == NULL)
+        return false;
+
+    for (unsigned i = 0; i < host_dma.n; ++i)
+        dst[i] = host_dma.next_sample++;
+    host_time_us += 1000;
+
+    // Si la interrupcion no rearranca nada el DMA queda detenido.
+    host_dma.dst = NULL;
+    DMA_IRQHandler();
+    return true;
+}
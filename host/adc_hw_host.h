@@ -0,0 +1,42 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __ADC_HW_HOST_H__
+#define __ADC_HW_HOST_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * Reemplazo en la PC de la capa adc_hw_dma_* de adc.c.  No hay GPDMA: la
+ * transferencia en curso queda anotada y adc_hw_host_complete la "termina",
+ * llenando el destino con muestras consecutivas y llamando a DMA_IRQHandler
+ * como lo haria el hardware.
+ */
+
+typedef struct _adc_hw_host
+{
+    uint8_t*    dst;        // Transferencia en curso, NULL si no hay
+    unsigned    n;
+    uint8_t     next_sample;
+    unsigned    transfers;  // adc_hw_dma_transfer, incluidas las de restart
+    unsigned    restarts;   // adc_hw_dma_restart
+    unsigned    stops;
+    bool        fail_setup; // adc_hw_dma_setup devuelve -1
+    bool        misaligned; // La proxima transferencia termina corrida
+}
+adc_hw_host;
+
+extern adc_hw_host host_dma;
+
+/**
+ * Termina la transferencia en curso, si la hay, y entra a la interrupcion.
+ * Devuelve false si el DMA estaba detenido.
+ */
+bool adc_hw_host_complete( void );
+
+#endif
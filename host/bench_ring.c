@@ -0,0 +1,108 @@
+/*
+ * Operaciones por segundo de buffer_queue en la PC, compilado una vez con las
+ * colas (BUFFER_QUEUE_RING 0) y otra con index_ring (BUFFER_QUEUE_RING 1).
+ * La cola es la de freertos_host.c, una copia dentro de un mutex, que imita
+ * el costo de la de FreeRTOS pero no es la misma; la comparacion en la placa
+ * la hace bench_buffer_queue (bench.h).
+ *   bench_ring_queue [n]
+ *   bench_ring_ring  [n]
+ */
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "buffer_queue.h"
+#include "task.h"
+
+
+#define N_BUFS      8
+#define BUF_SIZE    16
+
+static uint8_t      s__mem[N_BUFS * BUF_SIZE];
+static buffer_queue s__bq;
+
+
+static double s__now( void )
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void s__report( const char* name, unsigned long ops, double secs )
+{
+    printf("  %-28s %10.0f ops/s\n", name, ops / secs);
+}
+
+
+/**
+ * Un solo hilo: el ciclo completo de un buffer, cuatro operaciones.
+ */
+static void s__bench_cycle( unsigned n )
+{
+    buffer_queue_init(&s__bq, s__mem, BUF_SIZE, N_BUFS);
+
+    const double t0 = s__now();
+    for (unsigned i = 0; i < n; ++i)
+    {
+        uint8_t* buf = buffer_queue_get_avail(&s__bq, 0);
+        buffer_queue_push(&s__bq, buf);
+        buf = buffer_queue_get_inuse(&s__bq, 0);
+        buffer_queue_return(&s__bq, buf);
+    }
+    s__report("ciclo en un hilo", 4UL * n, s__now() - t0);
+}
+
+
+static unsigned s__n;
+
+static void* s__producer( void* arg )
+{
+    (void) arg;
+    for (unsigned i = 0; i < s__n; ++i)
+    {
+        uint8_t* buf;
+        while ((buf = buffer_queue_get_avail(&s__bq, 0)) == NULL)
+            sched_yield();
+        buffer_queue_push(&s__bq, buf);
+    }
+    return NULL;
+}
+
+/**
+ * Productor y consumidor en hilos distintos, como la tarea del ADC y
+ * vTaskApp.  El consumidor espera con timeout, asi con el anillo se mide
+ * tambien el aviso por el semaforo.
+ */
+static void s__bench_threads( unsigned n )
+{
+    buffer_queue_init(&s__bq, s__mem, BUF_SIZE, N_BUFS);
+    s__n = n;
+
+    pthread_t producer;
+    const double t0 = s__now();
+    pthread_create(&producer, NULL, s__producer, NULL);
+    for (unsigned i = 0; i < n; ++i)
+    {
+        uint8_t* buf;
+        while ((buf = buffer_queue_get_inuse(&s__bq, pdMS_TO_TICKS(10))) == NULL)
+            sched_yield();
+        buffer_queue_return(&s__bq, buf);
+    }
+    pthread_join(producer, NULL);
+    s__report("productor y consumidor", 4UL * n, s__now() - t0);
+}
+
+
+int main( int argc, char* argv[] )
+{
+    const unsigned n = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+
+    printf("buffer_queue con %s, %u ciclos\n",
+           BUFFER_QUEUE_RING ? "index_ring" : "colas (modelo de la PC)", n);
+    s__bench_cycle(n);
+    s__bench_threads(n);
+    return 0;
+}
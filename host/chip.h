@@ -0,0 +1,30 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __HOST_CHIP_H__
+#define __HOST_CHIP_H__
+
+#include <stdint.h>
+
+/**
+ * Lo unico de LPCOpen que usa tstamp.c: el TIMER1 es un contador en us que
+ * avanza el programa de prueba con host_time_us.
+ */
+
+extern uint32_t host_time_us;
+
+#define LPC_TIMER1      ((void*) 0)
+#define CLK_MX_TIMER1   0
+
+static inline void     Chip_TIMER_Init       ( void* t ) { (void) t; }
+static inline void     Chip_TIMER_Reset      ( void* t ) { (void) t; host_time_us = 0; }
+static inline void     Chip_TIMER_PrescaleSet( void* t, uint32_t p ) { (void) t; (void) p; }
+static inline void     Chip_TIMER_Enable     ( void* t ) { (void) t; }
+static inline uint32_t Chip_TIMER_ReadCount  ( void* t ) { (void) t; return host_time_us; }
+static inline uint32_t Chip_Clock_GetRate    ( int clk ) { (void) clk; return 1000000; }
+
+#endif
@@ -0,0 +1,47 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __HOST_FREERTOS_H__
+#define __HOST_FREERTOS_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <assert.h>
+
+/**
+ * Reemplazo minimo de FreeRTOS para compilar en la PC la logica de
+ * buffer_queue, index_ring y adc_dma (ver host/Makefile).  No hay scheduler:
+ * las "interrupciones" las llama el programa de prueba como funciones
+ * comunes, las colas no bloquean y las secciones criticas son un mutex
+ * recursivo, asi se pueden usar desde varios hilos.
+ */
+
+typedef uint32_t        TickType_t;
+typedef long            BaseType_t;
+typedef unsigned long   UBaseType_t;
+typedef uint32_t        StackType_t;
+
+typedef struct _host_task* TaskHandle_t;
+
+#define pdFALSE         0
+#define pdTRUE          1
+#define pdPASS          pdTRUE
+#define pdFAIL          pdFALSE
+#define portMAX_DELAY   ((TickType_t) 0xFFFFFFFFUL)
+#define portTICK_PERIOD_MS  1
+#define pdMS_TO_TICKS(x)    ((TickType_t) (x))
+
+#define configASSERT(x)     assert(x)
+
+void host_enter_critical( void );
+void host_exit_critical ( void );
+#define taskENTER_CRITICAL()        host_enter_critical()
+#define taskEXIT_CRITICAL()         host_exit_critical()
+#define portYIELD_FROM_ISR(x)       (void) (x)
+
+#endif
@@ -0,0 +1,39 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __HOST_QUEUE_H__
+#define __HOST_QUEUE_H__
+
+#include "FreeRTOS.h"
+
+/**
+ * Cola por copia dentro de una seccion critica, como la de FreeRTOS.  Solo la
+ * creacion estatica, que es la que usa buffer_queue.
+ */
+
+typedef struct _host_queue
+{
+    uint8_t*    mem;
+    UBaseType_t item_size;
+    UBaseType_t length;
+    UBaseType_t head;
+    UBaseType_t count;
+}
+StaticQueue_t;
+
+typedef StaticQueue_t* QueueHandle_t;
+
+QueueHandle_t xQueueCreateStatic( UBaseType_t uxQueueLength, UBaseType_t uxItemSize,
+                                  uint8_t* pucQueueStorage, StaticQueue_t* pxStaticQueue );
+BaseType_t  xQueueSendToBack      ( QueueHandle_t xQueue, const void* pvItem, TickType_t xTicksToWait );
+BaseType_t  xQueueReceive         ( QueueHandle_t xQueue, void* pvBuffer, TickType_t xTicksToWait );
+BaseType_t  xQueueSendToBackFromISR( QueueHandle_t xQueue, const void* pvItem, BaseType_t* pxHigherPriorityTaskWoken );
+BaseType_t  xQueueReceiveFromISR  ( QueueHandle_t xQueue, void* pvBuffer, BaseType_t* pxHigherPriorityTaskWoken );
+UBaseType_t uxQueueMessagesWaiting( QueueHandle_t xQueue );
+UBaseType_t uxQueueMessagesWaitingFromISR( QueueHandle_t xQueue );
+
+#endif
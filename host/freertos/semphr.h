@@ -0,0 +1,34 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __HOST_SEMPHR_H__
+#define __HOST_SEMPHR_H__
+
+#include <pthread.h>
+#include "FreeRTOS.h"
+
+/**
+ * Semaforo binario con un mutex y una condicion, este si bloquea para que dos
+ * hilos puedan esperarse (ver bench_ring.c).  Solo la creacion estatica.
+ */
+
+typedef struct _host_semaphore
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    unsigned        given;
+}
+StaticSemaphore_t;
+
+typedef StaticSemaphore_t* SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic( StaticSemaphore_t* pxSemaphoreBuffer );
+BaseType_t xSemaphoreTake        ( SemaphoreHandle_t xSemaphore, TickType_t xTicksToWait );
+BaseType_t xSemaphoreGive        ( SemaphoreHandle_t xSemaphore );
+BaseType_t xSemaphoreGiveFromISR ( SemaphoreHandle_t xSemaphore, BaseType_t* pxHigherPriorityTaskWoken );
+
+#endif
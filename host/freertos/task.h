@@ -0,0 +1,30 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __HOST_TASK_H__
+#define __HOST_TASK_H__
+
+#include "FreeRTOS.h"
+
+/**
+ * Cada hilo es una "tarea" con un contador de notificaciones.  El tick es el
+ * reloj monotono en ms.
+ */
+
+TickType_t   xTaskGetTickCount       ( void );
+TickType_t   xTaskGetTickCountFromISR( void );
+TaskHandle_t xTaskGetCurrentTaskHandle( void );
+uint32_t     ulTaskNotifyTake        ( BaseType_t xClearCountOnExit, TickType_t xTicksToWait );
+BaseType_t   xTaskNotifyGive         ( TaskHandle_t xTask );
+void         vTaskNotifyGiveFromISR  ( TaskHandle_t xTask, BaseType_t* pxHigherPriorityTaskWoken );
+
+/**
+ * Notificaciones pendientes de 'xTask', para las pruebas.
+ */
+uint32_t     host_task_notified      ( TaskHandle_t xTask );
+
+#endif
@@ -0,0 +1,224 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+#include "semphr.h"
+
+
+struct _host_task
+{
+    pthread_mutex_t lock;
+    pthread_cond_t  cond;
+    unsigned        count;
+};
+
+static pthread_mutex_t s__critical = PTHREAD_RECURSIVE_MUTEX_INITIALIZER_NP;
+static __thread struct _host_task s__task = {
+    PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0
+};
+
+
+void host_enter_critical( void )
+{
+    pthread_mutex_lock(&s__critical);
+}
+
+void host_exit_critical( void )
+{
+    pthread_mutex_unlock(&s__critical);
+}
+
+
+TickType_t xTaskGetTickCount( void )
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000UL + t.tv_nsec / 1000000UL;
+}
+
+TickType_t xTaskGetTickCountFromISR( void )
+{
+    return xTaskGetTickCount();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle( void )
+{
+    return &s__task;
+}
+
+/**
+ * Espera en 'cond' hasta que '*count' no sea 0 o pasen 'xTicksToWait' ms.
+ * Se llama con 'lock' tomado.
+ */
+static void s__wait( pthread_cond_t* cond, pthread_mutex_t* lock,
+                     volatile unsigned* count, TickType_t xTicksToWait )
+{
+    struct timespec until;
+    clock_gettime(CLOCK_REALTIME, &until);
+    if (xTicksToWait != portMAX_DELAY)
+    {
+        until.tv_sec  += xTicksToWait / 1000;
+        until.tv_nsec += (xTicksToWait % 1000) * 1000000L;
+        if (until.tv_nsec >= 1000000000L)
+        {
+            until.tv_sec++;
+            until.tv_nsec -= 1000000000L;
+        }
+    }
+
+    int err = 0;
+    while (*count == 0 && xTicksToWait != 0 && err != ETIMEDOUT)
+    {
+        if (xTicksToWait == portMAX_DELAY)
+            pthread_cond_wait(cond, lock);
+        else
+            err = pthread_cond_timedwait(cond, lock, &until);
+    }
+}
+
+uint32_t ulTaskNotifyTake( BaseType_t xClearCountOnExit, TickType_t xTicksToWait )
+{
+    struct _host_task* t = &s__task;
+    pthread_mutex_lock(&t->lock);
+    s__wait(&t->cond, &t->lock, &t->count, xTicksToWait);
+    uint32_t ret = t->count;
+    if (ret > 0)
+        t->count = xClearCountOnExit ? 0 : ret - 1;
+    pthread_mutex_unlock(&t->lock);
+    return ret;
+}
+
+BaseType_t xTaskNotifyGive( TaskHandle_t xTask )
+{
+    pthread_mutex_lock(&xTask->lock);
+    xTask->count++;
+    pthread_cond_signal(&xTask->cond);
+    pthread_mutex_unlock(&xTask->lock);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR( TaskHandle_t xTask, BaseType_t* pxHigherPriorityTaskWoken )
+{
+    xTaskNotifyGive(xTask);
+    if (pxHigherPriorityTaskWoken != NULL)
+        *pxHigherPriorityTaskWoken = pdTRUE;
+}
+
+uint32_t host_task_notified( TaskHandle_t xTask )
+{
+    pthread_mutex_lock(&xTask->lock);
+    uint32_t ret = xTask->count;
+    pthread_mutex_unlock(&xTask->lock);
+    return ret;
+}
+
+
+QueueHandle_t xQueueCreateStatic( UBaseType_t uxQueueLength, UBaseType_t uxItemSize,
+                                  uint8_t* pucQueueStorage, StaticQueue_t* pxStaticQueue )
+{
+    pxStaticQueue->mem       = pucQueueStorage;
+    pxStaticQueue->item_size = uxItemSize;
+    pxStaticQueue->length    = uxQueueLength;
+    pxStaticQueue->head      = 0;
+    pxStaticQueue->count     = 0;
+    return pxStaticQueue;
+}
+
+BaseType_t xQueueSendToBack( QueueHandle_t xQueue, const void* pvItem, TickType_t xTicksToWait )
+{
+    (void) xTicksToWait;
+    BaseType_t ret = pdFAIL;
+    host_enter_critical();
+    if (xQueue->count < xQueue->length)
+    {
+        const UBaseType_t pos = (xQueue->head + xQueue->count) % xQueue->length;
+        memcpy(xQueue->mem + pos * xQueue->item_size, pvItem, xQueue->item_size);
+        xQueue->count++;
+        ret = pdPASS;
+    }
+    host_exit_critical();
+    return ret;
+}
+
+BaseType_t xQueueReceive( QueueHandle_t xQueue, void* pvBuffer, TickType_t xTicksToWait )
+{
+    // Sin scheduler no hay quien llene la cola mientras se espera.
+    (void) xTicksToWait;
+    BaseType_t ret = pdFAIL;
+    host_enter_critical();
+    if (xQueue->count > 0)
+    {
+        memcpy(pvBuffer, xQueue->mem + xQueue->head * xQueue->item_size, xQueue->item_size);
+        xQueue->head = (xQueue->head + 1) % xQueue->length;
+        xQueue->count--;
+        ret = pdPASS;
+    }
+    host_exit_critical();
+    return ret;
+}
+
+BaseType_t xQueueSendToBackFromISR( QueueHandle_t xQueue, const void* pvItem, BaseType_t* pxHigherPriorityTaskWoken )
+{
+    (void) pxHigherPriorityTaskWoken;
+    return xQueueSendToBack(xQueue, pvItem, 0);
+}
+
+BaseType_t xQueueReceiveFromISR( QueueHandle_t xQueue, void* pvBuffer, BaseType_t* pxHigherPriorityTaskWoken )
+{
+    (void) pxHigherPriorityTaskWoken;
+    return xQueueReceive(xQueue, pvBuffer, 0);
+}
+
+UBaseType_t uxQueueMessagesWaiting( QueueHandle_t xQueue )
+{
+    host_enter_critical();
+    UBaseType_t ret = xQueue->count;
+    host_exit_critical();
+    return ret;
+}
+
+UBaseType_t uxQueueMessagesWaitingFromISR( QueueHandle_t xQueue )
+{
+    return uxQueueMessagesWaiting(xQueue);
+}
+
+
+SemaphoreHandle_t xSemaphoreCreateBinaryStatic( StaticSemaphore_t* pxSemaphoreBuffer )
+{
+    pthread_mutex_init(&pxSemaphoreBuffer->lock, NULL);
+    pthread_cond_init(&pxSemaphoreBuffer->cond, NULL);
+    pxSemaphoreBuffer->given = 0;
+    return pxSemaphoreBuffer;
+}
+
+BaseType_t xSemaphoreTake( SemaphoreHandle_t xSemaphore, TickType_t xTicksToWait )
+{
+    pthread_mutex_lock(&xSemaphore->lock);
+    s__wait(&xSemaphore->cond, &xSemaphore->lock, &xSemaphore->given, xTicksToWait);
+    const BaseType_t ret = xSemaphore->given ? pdTRUE : pdFALSE;
+    xSemaphore->given = 0;
+    pthread_mutex_unlock(&xSemaphore->lock);
+    return ret;
+}
+
+BaseType_t xSemaphoreGive( SemaphoreHandle_t xSemaphore )
+{
+    pthread_mutex_lock(&xSemaphore->lock);
+    const BaseType_t ret = xSemaphore->given ? pdFAIL : pdPASS;
+    xSemaphore->given = 1;
+    pthread_cond_signal(&xSemaphore->cond);
+    pthread_mutex_unlock(&xSemaphore->lock);
+    return ret;
+}
+
+BaseType_t xSemaphoreGiveFromISR( SemaphoreHandle_t xSemaphore, BaseType_t* pxHigherPriorityTaskWoken )
+{
+    if (pxHigherPriorityTaskWoken != NULL)
+        *pxHigherPriorityTaskWoken = pdTRUE;
+    return xSemaphoreGive(xSemaphore);
+}
@@ -0,0 +1,254 @@
+/*
+ * Prueba en la PC del intercambio de buffers de adc_dma con buffer_queue,
+ * sobre el reemplazo de la capa adc_hw_dma_* (adc_hw_host.c).  La
+ * "interrupcion" se dispara con adc_hw_host_complete desde el mismo hilo.
+ */
+#include <stdio.h>
+#include <string.h>
+
+#include "adc_dma.h"
+#include "adc_hw_host.h"
+#include "chip.h"
+
+
+#define N_BUFS      4
+#define HDR_LEN     5
+#define TS_OFFSET   1
+#define N_SAMPLES   3
+#define BUF_SIZE    (HDR_LEN + N_SAMPLES)
+#define PERIOD_US   100
+
+static unsigned s__fails;
+
+#define CHECK( cond )                                                           \
+    do {                                                                        \
+        if (!(cond))                                                            \
+        {                                                                       \
+            printf("  FALLA %s:%d: %s\n", __FILE__, __LINE__, #cond);           \
+            s__fails++;                                                         \
+        }                                                                       \
+    } while (0)
+
+
+static uint8_t      s__mem[N_BUFS * BUF_SIZE];
+static buffer_queue s__bq;
+static adc_dma_type s__ad;
+
+
+static void s__setup( void )
+{
+    static const uint8_t hdr[HDR_LEN] = { 0xA5, 0, 0, 0, 0 };
+
+    memset(&host_dma, 0, sizeof(host_dma));
+    host_time_us = 0;
+    CHECK(buffer_queue_init(&s__bq, s__mem, BUF_SIZE, N_BUFS) == 0);
+    adc_dma_init(&s__ad, &s__bq);
+    adc_dma_set_frame(&s__ad, hdr, HDR_LEN, N_SAMPLES);
+    adc_dma_set_timestamp(&s__ad, TS_OFFSET);
+    adc_dma_set_period(&s__ad, PERIOD_US, N_SAMPLES);
+}
+
+static uint32_t s__read32( const uint8_t* p )
+{
+    return p[0] | (p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+
+static void s__test_reserve( void )
+{
+    printf("reserva al arrancar\n");
+    s__setup();
+    adc_dma_start(&s__ad);
+
+    // 'active' en el DMA y 'next' reservado.
+    CHECK(s__ad.running);
+    CHECK(s__ad.active != NULL && s__ad.next != NULL);
+    CHECK(host_dma.dst == s__ad.active + HDR_LEN && host_dma.n == N_SAMPLES);
+    CHECK(buffer_queue_avail_count(&s__bq) == N_BUFS - 2);
+    CHECK(s__ad.active[0] == 0xA5 && s__ad.next[0] == 0xA5);
+}
+
+static void s__test_irq( void )
+{
+    printf("entrega desde la interrupcion\n");
+    s__setup();
+    adc_dma_start(&s__ad);
+    uint8_t* first = s__ad.active;
+    uint8_t* second = s__ad.next;
+
+    CHECK(adc_hw_host_complete());
+
+    // El lleno ya esta en uso sin pasar por la tarea, el DMA siguio con
+    // 'next' y la interrupcion reservo otro.
+    CHECK(buffer_queue_inuse_count(&s__bq) == 1);
+    CHECK(s__ad.active == second && s__ad.next != NULL);
+    CHECK(buffer_queue_avail_count(&s__bq) == N_BUFS - 3);
+    CHECK(host_task_notified(xTaskGetCurrentTaskHandle()) == 0);
+
+    uint8_t* buf = buffer_queue_get_inuse(&s__bq, 0);
+    CHECK(buf == first);
+    CHECK(buf[0] == 0xA5);
+    CHECK(buf[HDR_LEN] == 0 && buf[HDR_LEN + 1] == 1 && buf[HDR_LEN + 2] == 2);
+    // Marca de la primer muestra, N_SAMPLES-1 periodos antes del fin.
+    CHECK(s__read32(buf + TS_OFFSET) == 1000 - (N_SAMPLES - 1) * PERIOD_US);
+    CHECK(buffer_queue_get_meta(&s__bq, buf) == 1000 - (N_SAMPLES - 1) * PERIOD_US);
+    const adc_dma_buf_info* info = adc_dma_get_info(&s__ad, buf);
+    CHECK(info != NULL && info->seq == 0 && info->dropped == 0 && info->period_us == PERIOD_US);
+    buffer_queue_return(&s__bq, buf);
+}
+
+static void s__test_overrun( void )
+{
+    printf("overrun y rearranque\n");
+    s__setup();
+    adc_dma_start(&s__ad);
+
+    // Sin consumidor se descarta el mas viejo y el DMA nunca se detiene.
+    for (unsigned i = 0; i < 3 * N_BUFS; ++i)
+        CHECK(adc_hw_host_complete());
+    CHECK(s__ad.running);
+    CHECK(s__ad.dropped > 0);
+    CHECK(s__ad.overruns == 0);
+    // Los descartes no cuentan como sacados por el consumidor.
+    buffer_queue_stats st;
+    buffer_queue_get_stats(&s__bq, 0, &st);
+    CHECK(st.taken == 0);
+
+    // El que queda tiene la secuencia del ultimo completo y los descartes
+    // hasta el.
+    uint8_t* last = NULL;
+    uint8_t* b;
+    while ((b = buffer_queue_get_inuse(&s__bq, 0)) != NULL)
+    {
+        if (last != NULL)
+            buffer_queue_return(&s__bq, last);
+        last = b;
+    }
+    const adc_dma_buf_info* info = adc_dma_get_info(&s__ad, last);
+    CHECK(info != NULL && info->seq == 3 * N_BUFS - 1);
+    CHECK(info != NULL && info->dropped + 1 == s__ad.dropped);  // El ultimo descarte fue despues
+    buffer_queue_return(&s__bq, last);
+
+    // Con un solo consumidor la interrupcion siempre puede descartar el que
+    // acaba de llenar.  Un segundo consumidor que se queda con todo lo que
+    // recibe deja a la interrupcion sin 'next' y el DMA se detiene.
+    const int sink = buffer_queue_add_consumer(&s__bq);
+    uint8_t* held[N_BUFS];
+    unsigned n_held = 0;
+    uint8_t* buf;
+    for (unsigned i = 0; i < 3 * N_BUFS && adc_hw_host_complete(); ++i)
+    {
+        while ((buf = buffer_queue_get_inuse_by(&s__bq, sink, 0)) != NULL)
+            held[n_held++] = buf;
+        while ((buf = buffer_queue_get_inuse(&s__bq, 0)) != NULL)
+            buffer_queue_return(&s__bq, buf);
+    }
+    CHECK(!s__ad.running);
+    CHECK(s__ad.overruns == 1);
+    CHECK(n_held == N_BUFS);
+    CHECK(host_task_notified(xTaskGetCurrentTaskHandle()) > 0);
+
+    // Sin buffers la tarea no puede rearrancar.
+    adc_dma_update(&s__ad, 0);
+    CHECK(!s__ad.running);
+
+    // Con buffers devueltos si, y vuelve a tener 'next'.
+    const unsigned restarts = host_dma.restarts;
+    for (unsigned i = 0; i < n_held; ++i)
+        buffer_queue_return(&s__bq, held[i]);
+    adc_dma_update(&s__ad, 0);
+    CHECK(s__ad.running);
+    CHECK(host_dma.restarts == restarts + 1);
+    CHECK(s__ad.next != NULL);
+    CHECK(adc_hw_host_complete());
+    CHECK(buffer_queue_inuse_count(&s__bq) == 1);
+    CHECK(buffer_queue_inuse_count_by(&s__bq, sink) == 1);
+}
+
+static void s__test_misaligned( void )
+{
+    printf("barrido corrido\n");
+    s__setup();
+    adc_dma_start(&s__ad);
+    CHECK(adc_hw_host_complete());
+    CHECK(buffer_queue_inuse_count(&s__bq) == 1);
+
+    // El buffer corrido no se entrega y el DMA espera a la tarea.
+    host_dma.misaligned = true;
+    CHECK(adc_hw_host_complete());
+    CHECK(s__ad.misaligned == 1);
+    CHECK(!s__ad.running);
+    CHECK(s__ad.overruns == 0);
+    CHECK(buffer_queue_inuse_count(&s__bq) == 1);
+    CHECK(s__ad.next != NULL);
+    CHECK(buffer_queue_avail_count(&s__bq) + 2 == N_BUFS);  // En uso y next
+    CHECK(host_task_notified(xTaskGetCurrentTaskHandle()) > 0);
+
+    // La tarea lo rearranca resincronizando el ADC.
+    const unsigned restarts = host_dma.restarts;
+    adc_dma_update(&s__ad, 0);
+    CHECK(s__ad.running);
+    CHECK(host_dma.restarts == restarts + 1);
+    CHECK(adc_hw_host_complete());
+    CHECK(buffer_queue_inuse_count(&s__bq) == 2);
+}
+
+static void s__test_stop( void )
+{
+    printf("stop\n");
+    s__setup();
+    adc_dma_start(&s__ad);
+    CHECK(adc_hw_host_complete());
+
+    adc_dma_stop(&s__ad);
+    CHECK(!s__ad.running && host_dma.dst == NULL);
+    CHECK(s__ad.active == NULL && s__ad.next == NULL);
+    // 'active' y 'next' vuelven, el lleno queda entregado.
+    CHECK(buffer_queue_inuse_count(&s__bq) == 1);
+    CHECK(buffer_queue_avail_count(&s__bq) == N_BUFS - 1);
+    // Una interrupcion tardia no hace nada.
+    CHECK(!adc_hw_host_complete());
+}
+
+static void s__test_shared( void )
+{
+    printf("descarte con dos consumidores\n");
+    s__setup();
+    const int sink = buffer_queue_add_consumer(&s__bq);
+    CHECK(sink == 1);
+    adc_dma_start(&s__ad);
+
+    // El segundo consumidor se queda con el primer buffer.
+    CHECK(adc_hw_host_complete());
+    uint8_t* kept = buffer_queue_get_inuse_by(&s__bq, sink, 0);
+    CHECK(kept != NULL);
+    const uint8_t first = kept[HDR_LEN];
+
+    // Aunque el consumidor 0 no saque nada y se descarten buffers, el que
+    // tiene el otro consumidor no se vuelve a escribir.
+    for (unsigned i = 0; i < 3 * N_BUFS; ++i)
+    {
+        adc_hw_host_complete();
+        while (buffer_queue_inuse_count_by(&s__bq, sink) > 0)
+            buffer_queue_return(&s__bq, buffer_queue_get_inuse_by(&s__bq, sink, 0));
+    }
+    CHECK(s__ad.dropped > 0);
+    CHECK(kept[HDR_LEN] == first);
+    CHECK(kept != s__ad.active && kept != s__ad.next);
+    buffer_queue_return(&s__bq, kept);
+}
+
+
+int main( void )
+{
+    setvbuf(stdout, NULL, _IONBF, 0);
+    s__test_reserve();
+    s__test_irq();
+    s__test_overrun();
+    s__test_misaligned();
+    s__test_stop();
+    s__test_shared();
+
+    printf("%s (BUFFER_QUEUE_RING=%d): %u fallas\n", s__fails ? "MAL" : "OK", BUFFER_QUEUE_RING, s__fails);
+    return s__fails ? 1 : 0;
+}
@@ -0,0 +1,59 @@
+/*
+ * Prueba en la PC de resample.c: una rampa que pasa por varios cambios de
+ * relacion tiene que salir sin saltos para atras en el tiempo.
+ */
+#include <stdio.h>
+
+#include "resample.h"
+
+
+#define BLOCK       40
+
+static unsigned s__fails;
+
+
+int main( void )
+{
+    static const unsigned ratios[][2] = {
+        { 1, 1 }, { 1, 4 }, { 1, 8 }, { 3, 8 }, { 1, 4 }, { 1, 1 },
+    };
+    const unsigned n_ratios = sizeof(ratios) / sizeof(ratios[0]);
+
+    resample_type r;
+    resample_init(&r);
+
+    // El primer bloque llena la linea de retardo, se mira desde su ultima
+    // salida.
+    int prev = -1;
+    unsigned sample = 0;
+    for (unsigned b = 0; b < n_ratios; ++b)
+    {
+        if (resample_set_ratio(&r, ratios[b][0], ratios[b][1]) < 0)
+        {
+            printf("  FALLA relacion %u/%u\n", ratios[b][0], ratios[b][1]);
+            s__fails++;
+        }
+
+        uint8_t buf[BLOCK];
+        for (unsigned i = 0; i < BLOCK; ++i)
+            buf[i] = sample++;
+        const unsigned n = resample_apply(&r, buf, BLOCK);
+
+        printf("%u/%u:", ratios[b][0], ratios[b][1]);
+        for (unsigned i = 0; i < n; ++i)
+        {
+            printf(" %u", buf[i]);
+            if (b > 0 && buf[i] < prev)
+            {
+                printf(" <- FALLA");
+                s__fails++;
+            }
+        }
+        printf("\n");
+        if (n > 0)
+            prev = buf[n - 1];
+    }
+
+    printf("%s: %u fallas\n", s__fails ? "MAL" : "OK", s__fails);
+    return s__fails ? 1 : 0;
+}
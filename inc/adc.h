@@ -10,6 +10,7 @@
 #define __ADC_H__
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <stddef.h>
 
 #ifdef __cplusplus
@@ -31,6 +32,143 @@ void adc_init( void );
  */
 uint8_t adc_read( int chn );
 
+/**
+ * Cambia la resolucion del ADC0, 'bits' entre 8 y 10.
+ */
+void adc_set_resolution( unsigned bits );
+
+/**
+ * Igual que adc_read pero devuelve el resultado completo de 10 bits.  Usar
+ * junto con adc_set_resolution(10).
+ */
+uint16_t adc_read10( int chn );
+
+/**
+ * Funcion que atiende el fin de conversion del ADC0, se llama desde
+ * ADC0_IRQHandler con la muestra de 10 bits.  Devuelve true si desperto a una
+ * tarea de mayor prioridad.
+ */
+typedef bool (*adc_irq_handler)( uint16_t sample );
+
+/**
+ * Habilita la interrupcion de fin de conversion del canal 'chn' del ADC0 y
+ * llama a 'handler' por cada muestra.  No dispara conversiones, combinar con
+ * adc_timer_start.
+ */
+void adc_irq_start( int chn, adc_irq_handler handler );
+
+/**
+ * Deshabilita la interrupcion del canal 'chn'.
+ */
+void adc_irq_stop( int chn );
+
+/**
+ * Pone el ADC0 en modo burst (conversion continua) sobre el canal 'chn' a
+ * 'rate' muestras por segundo.
+ * Ojo que en burst la tasa minima la limita el divisor de clock del ADC (8
+ * bits), queda en el orden de las decenas de kHz.
+ */
+void adc_burst_start( int chn, uint32_t rate );
+
+/**
+ * Saca al ADC0 del modo burst y deshabilita el canal 'chn'.
+ */
+void adc_burst_stop( int chn );
+
+
+/**
+ * Pone el ADC0 en burst barriendo todos los canales de 'mask' (bit n para
+ * ADC_CHn), siempre en orden ascendente.  'rate' son conversiones por segundo
+ * en total, cada canal se muestrea a rate / (canales en mask).
+ */
+void adc_scan_start( uint8_t mask, uint32_t rate );
+
+/**
+ * Saca al ADC0 del modo burst y deshabilita los canales de 'mask'.
+ */
+void adc_scan_stop( uint8_t mask );
+
+/**
+ * Dispara las conversiones del canal 'chn' del ADC0 con el match del TIMER0,
+ * una cada 'period_us' microsegundos.  El disparo es por hardware (GIMA), no
+ * depende del tick de FreeRTOS ni de la latencia de ninguna interrupcion.
+ */
+void adc_timer_start( int chn, uint32_t period_us );
+
+/**
+ * Detiene el TIMER0 y deshabilita el canal 'chn'.
+ */
+void adc_timer_stop( int chn );
+
+/**
+ * Muestrea en paralelo el canal 'chn0' del ADC0 y 'chn1' del ADC1, ambos
+ * disparados por el TIMER3 cada 'period_us' microsegundos.
+ * Con 'offset' el ADC1 convierte medio periodo despues que el ADC0; como en el
+ * LPC4337 el canal n de los dos ADCs comparte el pin, con chn0 == chn1 se
+ * obtiene la misma senal al doble de tasa.  Sin 'offset' convierten a la vez.
+ */
+void adc_dual_start( int chn0, int chn1, uint32_t period_us, bool offset );
+
+/**
+ * Detiene el TIMER3 y deshabilita los canales de ambos ADCs.
+ */
+void adc_dual_stop( int chn0, int chn1 );
+
+
+/**
+ * Capa de hardware del GPDMA para el ADC0.  Solo se toca el hardware aca, la
+ * logica de intercambio de buffers esta en adc_dma.c, asi se la puede compilar
+ * en la PC reemplazando estas funciones.
+ */
+
+/**
+ * Reserva un canal del GPDMA para leer los resultados de los canales de 'mask'
+ * del ADC0 y habilita la interrupcion del GPDMA.  Con un solo canal se lee su
+ * registro de datos; con varios se lee el registro global, que tiene siempre
+ * la ultima conversion del barrido.  Devuelve -1 si no hay canales libres.
+ */
+int  adc_hw_dma_setup( uint8_t mask );
+
+/**
+ * Igual que adc_hw_dma_setup pero con un canal de DMA por ADC: el ADC0 lee
+ * 'chn0' y el ADC1 'chn1'.  Cada transferencia de n muestras se reparte, las
+ * primeras n/2 son del ADC0 y las siguientes del ADC1, y adc_hw_dma_ack solo
+ * indica el fin cuando terminaron los dos.
+ */
+int  adc_hw_dma_setup_dual( int chn0, int chn1 );
+
+/**
+ * Arranca una transferencia de 'n' muestras de 8 bits hacia 'dst'.  Al
+ * terminar se dispara DMA_IRQHandler.
+ */
+void adc_hw_dma_transfer( uint8_t* dst, unsigned n );
+
+/**
+ * Igual que adc_hw_dma_transfer pero resincroniza el ADC antes de arrancar: en
+ * un barrido lo reinicia para que la primer muestra vuelva a ser la del canal
+ * mas bajo.  Se usa al rearrancar despues de que el DMA se detuvo.
+ */
+void adc_hw_dma_restart( uint8_t* dst, unsigned n );
+
+/**
+ * Aborta la transferencia en curso, si la hubiera.
+ */
+void adc_hw_dma_stop( void );
+
+/**
+ * Llamar desde DMA_IRQHandler.  Limpia las interrupciones del canal reservado
+ * y devuelve true si la causa fue el fin de la transferencia.
+ */
+bool adc_hw_dma_ack( void );
+
+/**
+ * Despues de adc_hw_dma_ack: false si en un barrido la ultima muestra no era
+ * del canal que le tocaba, o sea que se perdio algun pedido de DMA y las
+ * muestras del buffer quedaron corridas.  Para volver a alinearlas hay que
+ * rearrancar con adc_hw_dma_restart.
+ */
+bool adc_hw_dma_aligned( void );
+
 
 #ifdef __cplusplus
 }
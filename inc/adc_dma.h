@@ -0,0 +1,159 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __ADC_DMA_H__
+#define __ADC_DMA_H__
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "buffer_queue.h"
+#include "tstamp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Adquisicion del ADC0 por GPDMA directo sobre los buffers de un buffer_queue.
+ * Funciona de la siguiente manera:
+ *   1. El ADC convierte solo (burst) y el GPDMA copia cada resultado al buffer
+ *      'active', la CPU no interviene por muestra.
+ *   2. Siempre hay un segundo buffer reservado, 'next'.  Cuando el DMA termina
+ *      de llenar 'active' la interrupcion rearranca el DMA sobre 'next' en el
+ *      momento, asi no se pierden muestras.
+ *   3. La misma interrupcion entrega el buffer lleno a la lista en uso y
+ *      reserva un 'next' nuevo, con la API _from_isr de buffer_queue, sin
+ *      pasar por ninguna tarea.
+ *   4. Si no hay buffers disponibles se descarta el mas viejo en uso, igual
+ *      que adc_update.  Si aun asi no hay 'next' el DMA se detiene, se cuenta
+ *      un overrun y se despierta a la tarea duena (la que llamo a
+ *      adc_dma_start), que desde adc_dma_update lo vuelve a arrancar cuando
+ *      haya un buffer.
+ *   5. En un barrido, si adc_hw_dma_aligned indica que las muestras quedaron
+ *      corridas de canal, el buffer se descarta y el DMA se detiene igual que
+ *      en un overrun, asi la tarea lo rearranca alineado.
+ * Todo el acceso al hardware esta en adc.c (adc_hw_dma_*).
+ */
+
+/// Tamano maximo del encabezado fijo de cada buffer.
+#define ADC_DMA_HDR_MAX     8
+
+/**
+ * Datos de cada buffer entregado, los anota la interrupcion antes del push.
+ * La marca de tiempo de la primer muestra va en los metadatos del buffer
+ * (buffer_queue_get_meta).
+ */
+typedef struct _adc_dma_buf_info
+{
+    uint32_t    period_us;  // Tiempo entre muestras
+    uint32_t    dropped;    // 'dropped' acumulado al entregarlo
+    uint16_t    seq;        // Uno por buffer completo, tambien los descartados
+}
+adc_dma_buf_info;
+
+
+typedef struct _adc_dma_type
+{
+    buffer_queue*       bq;
+    TaskHandle_t        task;    // Tarea que rearranca el DMA si se detiene
+
+    // Formato de cada buffer: encabezado fijo + 'len' muestras por DMA
+    uint8_t             hdr[ADC_DMA_HDR_MAX];
+    unsigned            hdr_len;
+    unsigned            len;
+    int                 ts_offset;  // Donde va la marca de tiempo, -1 si no va
+    uint32_t            period_us;  // Tiempo entre muestras
+    unsigned            n_periods;  // Periodos que abarca un buffer
+
+    // Compartidos con la interrupcion
+    uint8_t* volatile   active;  // Lo esta llenando el DMA
+    uint8_t* volatile   next;    // Reservado para cuando termine active
+    volatile bool       running;
+
+    // Estadisticas
+    volatile unsigned   overruns;  // Veces que el DMA se detuvo sin buffer
+    unsigned            dropped;   // Buffers en uso descartados
+    volatile unsigned   misaligned; // Buffers descartados por un barrido corrido
+    tstamp_jitter       jitter;    // Intervalo entre buffers completos
+
+    // Por buffer, indexado con buffer_queue_index
+    uint16_t            seq;
+    adc_dma_buf_info    info[BUFFER_QUEUE_MAX];
+}
+adc_dma_type;
+
+
+/**
+ * Inicializa la estructura.  El hardware se configura aparte, con
+ * adc_hw_dma_setup o adc_hw_dma_setup_dual.
+ * Por defecto el DMA llena el buffer completo, sin encabezado.
+ */
+void adc_dma_init  ( adc_dma_type* ad, buffer_queue* bq );
+
+/**
+ * Cambia el formato de los buffers: cada buffer empieza con los 'hdr_len'
+ * bytes de 'hdr' y el DMA escribe 'len' muestras a continuacion.  Llamar antes
+ * de adc_dma_start.
+ */
+void adc_dma_set_frame( adc_dma_type* ad, const uint8_t* hdr, unsigned hdr_len, unsigned len );
+
+/**
+ * Indica el tiempo entre muestras en us y cuantos de esos periodos abarca un
+ * buffer.  Se usa para medir el jitter entre buffers y para calcular la marca
+ * de tiempo de la primer muestra.
+ */
+void adc_dma_set_period( adc_dma_type* ad, uint32_t period_us, unsigned n );
+
+/**
+ * Escribe en el encabezado de cada buffer, a partir de 'offset', la marca de
+ * tiempo de la primer muestra (tstamp_now, 4 bytes little endian).  Con -1 no
+ * se escribe.  Llamar despues de adc_dma_set_frame.
+ */
+void adc_dma_set_timestamp( adc_dma_type* ad, int offset );
+
+/**
+ * Datos de un buffer entregado, NULL si 'buf' no es del buffer_queue.  Un
+ * salto en 'seq' es un buffer descartado.
+ */
+const adc_dma_buf_info* adc_dma_get_info( const adc_dma_type* ad, const uint8_t* buf );
+
+/**
+ * Copia la estadistica de jitter en 'out' y la reinicia.
+ */
+void adc_dma_take_jitter( adc_dma_type* ad, tstamp_jitter* out );
+
+/**
+ * Arranca la adquisicion.  Se debe llamar desde la tarea que despues llama a
+ * adc_dma_update, que es la que recibe las notificaciones.
+ */
+void adc_dma_start ( adc_dma_type* ad );
+
+/**
+ * Detiene el DMA y devuelve los buffers reservados a la lista de disponibles.
+ * Lo que ya estaba lleno ya se entrego desde la interrupcion.
+ */
+void adc_dma_stop  ( adc_dma_type* ad );
+
+/**
+ * Espera como maximo 'xTicksToWait' una notificacion de la interrupcion,
+ * reserva el proximo buffer si hace falta y rearranca el DMA si se detuvo.
+ */
+void adc_dma_update( adc_dma_type* ad, TickType_t xTicksToWait );
+
+/**
+ * Logica de fin de transferencia, la llama DMA_IRQHandler.
+ */
+void adc_dma_irq   ( adc_dma_type* ad, BaseType_t* pxHigherPriorityTaskWoken );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,62 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __ADC_STREAM_H__
+#define __ADC_STREAM_H__
+
+#include <FreeRTOS.h>
+#include <stream_buffer.h>
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Productor del ADC0 por interrupcion sobre un stream buffer de FreeRTOS.
+ * El TIMER0 dispara las conversiones y la interrupcion de fin de conversion
+ * escribe cada muestra de 8 bits en el stream buffer.  El nivel de disparo
+ * del stream buffer hace que el consumidor se despierte una sola vez cada
+ * 'trigger' bytes, no hay ninguna tarea intermedia.
+ * Si el stream buffer esta lleno la muestra nueva se descarta y se cuenta en
+ * 'dropped'.
+ */
+
+typedef struct _adc_stream_type
+{
+    StreamBufferHandle_t    sb;
+    StaticStreamBuffer_t    sb_static;
+    volatile unsigned       dropped;
+}
+adc_stream_type;
+
+
+/**
+ * Crea el stream buffer sobre 'mem', que debe tener 'size' + 1 bytes y
+ * persistir, igual que en buffer_queue_init.  El consumidor se despierta
+ * cuando hay 'trigger' bytes.  Devuelve -1 si no se pudo crear.
+ */
+int    adc_stream_init ( adc_stream_type* as, uint8_t* mem, size_t size, size_t trigger );
+
+/**
+ * Arranca (o reprograma) el muestreo del canal 'chn', una muestra cada
+ * 'period_us'.
+ */
+void   adc_stream_start( adc_stream_type* as, int chn, uint32_t period_us );
+
+/**
+ * Espera como maximo 'xTicksToWait' a que haya 'n' muestras y las copia en
+ * 'buf'.  Devuelve la cantidad copiada.
+ */
+size_t adc_stream_read ( adc_stream_type* as, uint8_t* buf, size_t n, TickType_t xTicksToWait );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
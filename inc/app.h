@@ -15,6 +15,21 @@
 
 #include "config.h"
 #include "buffer_queue.h"
+#include "adc_dma.h"
+#include "tstamp.h"
+#include "pack10.h"
+#include "frontend.h"
+#include "governor.h"
+#include "summary.h"
+#include "events.h"
+#include "goertzel.h"
+#include "codec.h"
+#include "scale.h"
+#include "filter.h"
+#include "calib.h"
+#include "resample.h"
+#include "adc_stream.h"
+#include "capture.h"
 #include "debouncing.h"
 
 #ifdef __cplusplus
@@ -24,6 +39,12 @@ extern "C" {
 
 /// Nombre del archivo de configuracion en la SD.
 #define APP_SD_CONFIG_FILENAME  "config.bin"
+/// Nombre del archivo de coeficientes del filtro en la SD (ver filter.h).
+#define APP_SD_FILTER_FILENAME  "filter.bin"
+/// Nombre del archivo de calibracion por canal en la SD (ver calib.h).
+#define APP_SD_CALIB_FILENAME   "calib.bin"
+/// Nombre del archivo de tonos de APP_PROC_GOERTZEL en la SD (ver goertzel.h).
+#define APP_SD_TONES_FILENAME   "tones.bin"
 
 /// Timeout de espera de respuesta por Bluetooth en ms.
 #define APP_BLUETOOTH_TIMEOUT   250
@@ -33,6 +54,255 @@ extern "C" {
 /// Tiempo de actualizacion del acelerometro en ms.
 #define APP_ACCEL_TASK_PERIOD   1000
 
+/// Modos de adquisicion del ADC para APP_ADC_MODE.
+#define APP_ADC_MODE_POLL       0  /// vTaskADC lee una muestra por periodo.
+#define APP_ADC_MODE_DMA        1  /// ADC0 en burst, el GPDMA llena los buffers.
+#define APP_ADC_MODE_TIMER      2  /// Disparo por TIMER0, el GPDMA llena los buffers.
+#define APP_ADC_MODE_SCAN       3  /// Burst barriendo APP_ADC_SCAN_MASK, por GPDMA.
+#define APP_ADC_MODE_DUAL       4  /// ADC0 y ADC1 en paralelo por TIMER3, por GPDMA.
+#define APP_ADC_MODE_STREAM     5  /// Disparo por TIMER0, la IRQ llena un stream buffer.
+#define APP_ADC_MODE_CAPTURE    6  /// Disparo por TIMER0, solo ventanas con pretrigger.
+
+/// Modo de adquisicion del ADC.
+#define APP_ADC_MODE            APP_ADC_MODE_POLL
+/// Tasa de muestreo en Hz para APP_ADC_MODE_DMA (ignora sample_period).
+#define APP_ADC_DMA_RATE        100000
+/// Cada cuanto se reintenta reservar el canal de DMA si no habia libres, en ms.
+#define APP_ADC_DMA_RETRY_MS    1000
+/// Canales a barrer en APP_ADC_MODE_SCAN, bit n para ADC_CHn.
+#define APP_ADC_SCAN_MASK       ((1 << ADC_CH1) | (1 << ADC_CH2) | (1 << ADC_CH3) | (1 << ADC_CH4))
+/// Conversiones por segundo en APP_ADC_MODE_SCAN, sumando todos los canales.
+#define APP_ADC_SCAN_RATE       100000
+
+/// Canal del ADC0 en APP_ADC_MODE_DUAL.
+#define APP_ADC_DUAL_CHANNEL0   ADC_CH2
+/// Canal del ADC1 en APP_ADC_MODE_DUAL.
+#define APP_ADC_DUAL_CHANNEL1   ADC_CH2
+/**
+ * 1: el ADC1 muestrea medio periodo despues que el ADC0 (con el mismo canal es
+ * la misma senal al doble de tasa).  0: los dos muestrean a la vez.
+ */
+#define APP_ADC_DUAL_OFFSET     1
+
+/// Los modos del ADC que usan el GPDMA.
+#define APP_ADC_USES_DMA        (APP_ADC_MODE == APP_ADC_MODE_DMA   || \
+                                 APP_ADC_MODE == APP_ADC_MODE_TIMER || \
+                                 APP_ADC_MODE == APP_ADC_MODE_SCAN  || \
+                                 APP_ADC_MODE == APP_ADC_MODE_DUAL)
+/// Los modos del ADC disparados por timer, usan sample_period_us.
+#define APP_ADC_USES_TIMER      (APP_ADC_MODE == APP_ADC_MODE_TIMER || \
+                                 APP_ADC_MODE == APP_ADC_MODE_DUAL  || \
+                                 APP_ADC_MODE == APP_ADC_MODE_CAPTURE)
+
+/**
+ * Captura en APP_ADC_MODE_CAPTURE (ver capture.h).  Se guardan las
+ * APP_CAPTURE_PRE muestras anteriores al disparo y APP_CAPTURE_POST desde el
+ * disparo, en la memoria de los buffers, y solo esa ventana se manda por
+ * Bluetooth.  La ventana tiene que entrar en
+ * APP_DATA_BUF_SIZE * APP_DATA_BUF_NMBR.
+ */
+#define APP_CAPTURE_PRE         32
+#define APP_CAPTURE_POST        64
+/// Nivel de disparo, en cuentas de 8 bits.
+#define APP_CAPTURE_LEVEL       128
+/// Sentido del cruce, CAPTURE_RISING, CAPTURE_FALLING o CAPTURE_BOTH.
+#define APP_CAPTURE_EDGE        CAPTURE_RISING
+/// Salto minimo entre la muestra anterior y la del disparo, 0 para cualquiera.
+#define APP_CAPTURE_SLOPE       0
+/**
+ * Cada ventana se manda con este encabezado, little endian:
+ *   [0..1]  cantidad de muestras antes del disparo.
+ *   [2..3]  cantidad de muestras desde el disparo.
+ *   [4..7]  marca de tiempo de la muestra del disparo en us (tstamp).
+ *   [8..11] periodo de muestreo en us.
+ */
+#define APP_CAPTURE_HDR_SIZE    12
+
+/**
+ * Politicas de adc_update cuando no hay buffers disponibles (overrun):
+ *   DROP_OLDEST: se descarta el buffer en uso mas viejo, datos frescos.
+ *   DROP_NEWEST: se descartan las muestras nuevas hasta que haya lugar.
+ *   BLOCK:       se espera un buffer hasta APP_OVERRUN_BLOCK_MS, si no llega
+ *                se descarta la muestra como en DROP_NEWEST.
+ *   DECIMATE:    se descarta la muestra y se duplica la decimacion de los
+ *                buffers siguientes (hasta 2^APP_OVERRUN_DECIM_MAX), se vuelve
+ *                de a un paso cuando queda libre la mitad de los buffers.  El
+ *                periodo del encabezado APP_BUF_HDR ya incluye la decimacion.
+ * Solo en APP_ADC_MODE_POLL.  Se cambia en ejecucion con la tecla arriba o
+ * con app_set_overrun_policy.
+ */
+#define APP_OVERRUN_DROP_OLDEST 0
+#define APP_OVERRUN_DROP_NEWEST 1
+#define APP_OVERRUN_BLOCK       2
+#define APP_OVERRUN_DECIMATE    3
+#define APP_OVERRUN_N_POLICIES  4
+
+/// Politica de overrun al arrancar.
+#define APP_OVERRUN_POLICY      APP_OVERRUN_DROP_OLDEST
+/// Espera maxima por un buffer en APP_OVERRUN_BLOCK, en ms.
+#define APP_OVERRUN_BLOCK_MS    5
+/// Decimacion maxima en APP_OVERRUN_DECIMATE, como log2.
+#define APP_OVERRUN_DECIM_MAX   4
+
+/**
+ * 1: el periodo de muestreo (sample_period) lo regula governor.h segun la
+ * ocupacion de la cola de muestras y la latencia de la respuesta Bluetooth,
+ * evaluando una vez por buffer enviado.  El regulador lleva su propio periodo
+ * (governor_period), que es el que aplica la tarea del ADC, asi sus cambios no
+ * se guardan en la SD.  Las teclas siguen funcionando: el regulador parte del
+ * periodo nuevo y puede volver a cambiarlo.  Solo en APP_ADC_MODE_POLL y
+ * APP_ADC_MODE_STREAM.
+ */
+#define APP_GOVERNOR            0
+/// Ocupacion de la cola en % a partir de la cual se muestrea mas lento.
+#define APP_GOVERNOR_HI_PCT     75
+/// Ocupacion de la cola en % por debajo de la cual se muestrea mas rapido.
+#define APP_GOVERNOR_LO_PCT     25
+/// Latencia maxima aceptada de la respuesta Bluetooth en ms.
+#define APP_GOVERNOR_LATENCY_MS (APP_BLUETOOTH_TIMEOUT / 2)
+/// Buffers seguidos con carga alta antes de muestrear mas lento.
+#define APP_GOVERNOR_HOLD_UP    2
+/// Buffers seguidos con carga baja antes de muestrear mas rapido.
+#define APP_GOVERNOR_HOLD_DOWN  8
+
+#if APP_GOVERNOR && APP_ADC_MODE != APP_ADC_MODE_POLL && APP_ADC_MODE != APP_ADC_MODE_STREAM
+#error "APP_GOVERNOR solo esta soportado en APP_ADC_MODE_POLL y APP_ADC_MODE_STREAM"
+#endif
+
+/// Cada cuanto se imprime el jitter de muestreo medido, en ms.
+#define APP_JITTER_REPORT_PERIOD 10000
+
+/**
+ * Resolucion del ADC en bits: 8, o 10 con las muestras empaquetadas de a 4 en
+ * 5 bytes (ver pack10.h).  Solo en APP_ADC_MODE_POLL.
+ */
+#define APP_ADC_BITS            8
+
+/**
+ * Front-end de sobremuestreo en APP_ADC_MODE_POLL (ver frontend.h).  Con
+ * orden 0 no se usa y se lee una muestra por periodo.  Si no, el ADC muestrea
+ * a 2^APP_ADC_CIC_LOG2_RATIO veces la tasa configurada y un CIC de ese orden
+ * entrega las muestras de APP_ADC_BITS bits a la tasa configurada.
+ * Tiene que cumplirse 10 + orden * log2_ratio <= 32.
+ */
+#define APP_ADC_CIC_ORDER       0
+#define APP_ADC_CIC_LOG2_RATIO  4
+
+/// Procesamiento de las muestras en vTaskApp antes de mandarlas, para APP_PROC_MODE.
+#define APP_PROC_RAW            0  /// Las muestras escaladas por el acelerometro (ver scale.h).
+#define APP_PROC_FFT            1  /// Espectro de magnitud promediado (ver spectrum.h).
+#define APP_PROC_SUMMARY        2  /// Minimo, maximo, media y RMS por bloque (ver summary.h).
+#define APP_PROC_CODEC          3  /// Bloques comprimidos (ver codec.h).
+#define APP_PROC_EVENTS         4  /// Picos, cruces y rachas fuera de limites (ver events.h).
+#define APP_PROC_GOERTZEL       5  /// Amplitud de unos pocos tonos (ver goertzel.h).
+
+/// Procesamiento de las muestras.
+#define APP_PROC_MODE           APP_PROC_RAW
+
+/**
+ * Muestras por bloque de la FFT en APP_PROC_FFT, potencia de 2 entre 32 y
+ * SPECTRUM_MAX_SIZE, y cuantos bloques se promedian por espectro enviado.
+ * Se mandan APP_FFT_SIZE bytes por cada APP_FFT_SIZE * APP_FFT_AVERAGE
+ * muestras.
+ */
+#define APP_FFT_SIZE            128
+#define APP_FFT_AVERAGE         16
+/**
+ * En APP_PROC_FFT cada espectro se manda con este formato, little endian:
+ *   [0..1] cantidad N de bins (APP_FFT_SIZE / 2), de 0 a fs/2.
+ *   [2..]  N bins de 16 bits, amplitud en cuentas en punto fijo 8.8.
+ */
+#define APP_FFT_HDR_SIZE        2
+
+// APP_PROC_FFT depende de que el espectro se compile con CMSIS-DSP.
+#include "spectrum.h"
+#if APP_PROC_MODE == APP_PROC_FFT && !SPECTRUM_USED
+#error "APP_PROC_FFT necesita SPECTRUM_USED=1 y CMSIS-DSP (ver config.mk)"
+#endif
+
+/**
+ * Muestras por registro en APP_PROC_SUMMARY, de 1 a 65535.  Cada bloque se
+ * manda como un registro de SUMMARY_RECORD_SIZE bytes (ver summary_encode).
+ */
+#define APP_SUMMARY_SIZE        256
+
+/**
+ * Codec de APP_PROC_CODEC (CODEC_RICE sin perdida o CODEC_ADPCM con perdida)
+ * y muestras por bloque comprimido, hasta 65535.  Cada bloque se manda con el
+ * formato de codec.h; bloques mas grandes comprimen mas pero tardan mas en
+ * salir.
+ */
+#define APP_CODEC               CODEC_RICE
+#define APP_CODEC_BLOCK         128
+
+/**
+ * Parametros del detector de APP_PROC_EVENTS (ver events_init): prominencia
+ * minima de los picos, nivel de cruce con su histeresis, limites de las rachas
+ * y largo minimo de una racha, en cuentas y muestras.  Cada buffer con
+ * eventos se manda como hasta APP_EVENTS_MAX registros de EVENTS_RECORD_SIZE
+ * bytes por mensaje (ver events_encode), sin eventos no se manda nada.
+ */
+#define APP_EVENTS_PROMINENCE   16
+#define APP_EVENTS_LEVEL        128
+#define APP_EVENTS_HYST         4
+#define APP_EVENTS_LO           16
+#define APP_EVENTS_HI           240
+#define APP_EVENTS_MIN_RUN      4
+#define APP_EVENTS_MAX          16
+
+/**
+ * Muestras por ventana en APP_PROC_GOERTZEL, hasta GOERTZEL_SIZE_MAX.  Los
+ * tonos se leen de APP_SD_TONES_FILENAME, sin archivo no se manda nada.  Cada
+ * ventana se manda con este formato, little endian:
+ *   [0]   cantidad N de tonos, en el orden del archivo.
+ *   [1..] N amplitudes de 16 bits, en cuentas en punto fijo 8.8.
+ */
+#define APP_GOERTZEL_SIZE       256
+#define APP_GOERTZEL_HDR_SIZE   1
+
+/// 1: al arrancar vTaskApp imprime los benchmarks de bench.h.
+#define APP_BENCH               0
+
+/// Los modos con un solo canal de 8 bits en flujo continuo.
+#define APP_ADC_SINGLE_8BIT     (APP_ADC_BITS == 8 && \
+                                 APP_ADC_MODE != APP_ADC_MODE_SCAN && \
+                                 APP_ADC_MODE != APP_ADC_MODE_DUAL && \
+                                 APP_ADC_MODE != APP_ADC_MODE_CAPTURE)
+
+#if APP_PROC_MODE != APP_PROC_RAW && !APP_ADC_SINGLE_8BIT
+#error "APP_PROC_MODE necesita un solo canal de 8 bits en flujo continuo"
+#endif
+
+/**
+ * 1: las muestras pasan por el filtro de filter.h antes del procesamiento,
+ * con los coeficientes de APP_SD_FILTER_FILENAME.  Sin archivo no se filtra.
+ * El diezmado tiene que dividir a APP_DATA_BUF_SIZE, asi cada buffer queda con
+ * APP_DATA_BUF_SIZE / diezmado muestras (salvo los que salen antes por
+ * APP_FLUSH_MS).  Solo con APP_ADC_SINGLE_8BIT.
+ */
+#define APP_FILTER              1
+#define APP_FILTER_USED         (APP_FILTER && APP_ADC_SINGLE_8BIT)
+
+/**
+ * 1: el ADC muestrea siempre a la tasa mas alta (APP_ADC_MIN_RATE) y la
+ * salida se remuestrea (ver resample.h) despues del filtro.  sample_period,
+ * por botones o por APP_GOVERNOR, pasa a elegir la tasa de salida con la
+ * relacion (APP_ADC_MIN_RATE + 1) / (sample_period + 1), y con
+ * app_set_resample_ratio se puede pedir cualquier otra.  Solo con
+ * APP_ADC_SINGLE_8BIT.
+ */
+#define APP_RESAMPLE            0
+#define APP_RESAMPLE_USED       (APP_RESAMPLE && APP_ADC_SINGLE_8BIT)
+
+/**
+ * 1: cada buffer se calibra por canal (ver calib.h) antes de filtrarlo o
+ * mandarlo, con las tablas de APP_SD_CALIB_FILENAME.  Sin archivo quedan las
+ * cuentas crudas.  En APP_ADC_MODE_DUAL el ADC1 usa la tabla de su canal.
+ * Solo con APP_ADC_BITS == 8.
+ */
+#define APP_CALIB               1
+#define APP_CALIB_USED          (APP_CALIB && APP_ADC_BITS == 8)
+
 /// Canal del ADC a muestrear.
 #define APP_ADC_CHANNEL         ADC_CH2
 /// Periodo minimo de muestreo (Ts = APP_ADC_MIN_RATE + 1).
@@ -47,13 +317,157 @@ extern "C" {
 
 /// Cuantas muestras del ADC almacenar antes de enviarlas todas por Bluetooth.
 #define APP_DATA_BUF_SIZE       16
+/**
+ * Latencia maxima en ms de la primer muestra de un buffer en APP_ADC_MODE_POLL
+ * (con o sin CIC).  Si pasa el plazo y el buffer no se lleno se entrega como
+ * este, asi con tasas bajas las muestras no esperan a que se llene.  0 para
+ * esperar siempre el buffer completo.
+ */
+#define APP_FLUSH_MS            200
+
+/**
+ * 1: ademas de vTaskApp, cada buffer del ADC le llega a vTaskSinkUart, que lo
+ * vuelca en hexadecimal por la UART de mensajes.  Es un segundo consumidor
+ * del buffer_queue, asi que no se copia para la UART: vTaskApp procesa una
+ * copia y el buffer vuelve a estar disponible cuando lo liberaron los dos.
+ * La misma tarea informa el atraso de cada consumidor cada
+ * APP_JITTER_REPORT_PERIOD.  No en APP_ADC_MODE_STREAM ni CAPTURE.
+ */
+#define APP_SINK_UART           0
+
+/// Bytes de cada buffer que se llenan, en 10 bits solo grupos completos.
+#if APP_ADC_BITS == 10
+#define APP_DATA_BUF_USED       ((APP_DATA_BUF_SIZE / PACK10_BYTES) * PACK10_BYTES)
+#else
+#define APP_DATA_BUF_USED       APP_DATA_BUF_SIZE
+#endif
+
+#if APP_SINK_UART && (APP_ADC_MODE == APP_ADC_MODE_STREAM || APP_ADC_MODE == APP_ADC_MODE_CAPTURE)
+#error "APP_SINK_UART necesita el buffer_queue, no esta soportado en APP_ADC_MODE_STREAM ni CAPTURE"
+#endif
+#if APP_ADC_CIC_ORDER > 0 && APP_ADC_MODE != APP_ADC_MODE_POLL
+#error "APP_ADC_CIC_ORDER > 0 solo esta soportado en APP_ADC_MODE_POLL"
+#endif
+#if 10 + APP_ADC_CIC_ORDER * APP_ADC_CIC_LOG2_RATIO > 32
+#error "El CIC no entra en 32 bits, bajar APP_ADC_CIC_ORDER o APP_ADC_CIC_LOG2_RATIO"
+#endif
+
+#if APP_ADC_BITS == 10 && APP_ADC_MODE != APP_ADC_MODE_POLL
+#error "APP_ADC_BITS == 10 solo esta soportado en APP_ADC_MODE_POLL"
+#endif
+
+/**
+ * En APP_ADC_MODE_SCAN cada buffer es un frame con este encabezado:
+ *   [0] mascara de canales del barrido.
+ *   [1] cantidad N de muestras que siguen.
+ *   [2..N+1] muestras intercaladas, un barrido tras otro y dentro de cada
+ *            barrido en orden ascendente de canal.
+ * N es siempre multiplo de la cantidad de canales, el resto del buffer no se
+ * usa.
+ */
+#define APP_SCAN_HDR_SIZE       2
+/**
+ * En APP_ADC_MODE_DUAL cada buffer es un frame con este encabezado:
+ *   [0]    flags, APP_DUAL_FLAG_OFFSET si el ADC1 va desfasado medio periodo.
+ *   [1]    canal del ADC0 en los bits 3:0 y del ADC1 en los bits 7:4.
+ *   [2]    cantidad N de muestras de cada ADC.
+ *   [3..6] marca de tiempo de la primer muestra en us (tstamp, little endian).
+ *   [7..]  N muestras del ADC0 y luego N muestras del ADC1.
+ * Por Bluetooth se manda el encabezado y las muestras ya intercaladas
+ * (ADC0, ADC1, ADC0, ...), que con desfasaje es la senal en orden temporal.
+ */
+#define APP_DUAL_HDR_SIZE       7
+#define APP_DUAL_HDR_TSTAMP     3
+#define APP_DUAL_FLAG_OFFSET    0x01
+/**
+ * 1: en APP_ADC_MODE_POLL (con o sin CIC), APP_ADC_MODE_DMA y
+ * APP_ADC_MODE_TIMER cada buffer se manda por Bluetooth precedido por este
+ * encabezado, todo little endian:
+ *   [0..1]   numero de secuencia, uno por buffer completo: en POLL los que
+ *            entrega adc_update, en DMA y TIMER los que termina el DMA.
+ *   [2..5]   marca de tiempo de la primer muestra en us (tstamp).
+ *   [6..9]   periodo de muestreo en us, ya multiplicado por el diezmado del
+ *            filtro y por down/up del remuestreo.
+ *   [10..13] cantidad acumulada de buffers descartados: con
+ *            APP_OVERRUN_DROP_OLDEST en POLL, adc_dma.dropped con DMA.
+ *   [14..15] cantidad de bytes que siguen, menos que APP_DATA_BUF_SIZE si el
+ *            buffer salio antes por APP_FLUSH_MS o por el diezmado.
+ * Un salto en la secuencia es un buffer descartado, las muestras descartadas
+ * con las otras politicas y las que se pierden con el DMA detenido se ven en
+ * la marca de tiempo.  Cuando cambia el periodo de muestreo el buffer a medio
+ * llenar se reinicia, asi cada buffer tiene un solo periodo.  Con
+ * APP_PROC_MODE no se manda.
+ * En POLL los datos los anota adc_update en buf_hdr; con DMA los anota la
+ * interrupcion de adc_dma (ver adc_dma_get_info).  SCAN y DUAL mandan en su
+ * lugar su propio encabezado de frame (APP_SCAN_HDR_SIZE, APP_DUAL_HDR_SIZE),
+ * y STREAM y CAPTURE no usan buffer_queue.
+ */
+#define APP_BUF_HDR             1
+#define APP_BUF_HDR_SIZE        16
+/// Si corresponde mandar el encabezado de buffer con APP_ADC_MODE.
+#define APP_BUF_HDR_USED        (APP_BUF_HDR && APP_PROC_MODE == APP_PROC_RAW && \
+                                 (APP_ADC_MODE == APP_ADC_MODE_POLL || \
+                                  APP_ADC_MODE == APP_ADC_MODE_DMA  || \
+                                  APP_ADC_MODE == APP_ADC_MODE_TIMER))
+
 /**
  * Cuantos buffers se crearan para almacenar muestras del ADC.
  * Estos son los que se utilizaran con buffer_queue para intercambiar datos
- * entre la tarea del ADC y de APP.
+ * entre la tarea del ADC y de APP.  En APP_ADC_MODE_STREAM la misma memoria es
+ * el almacenamiento del stream buffer y en APP_ADC_MODE_CAPTURE la ventana.
+ * La memoria es estatica, igual que la de las tareas, semaforos y colas (no
+ * se usa el heap de FreeRTOS), asi que se puede agrandar hasta lo que entre
+ * en la RAM al linkear.  Con buffer_queue hay hasta BUFFER_QUEUE_MAX buffers,
+ * que se define al compilar (ver buffer_queue.h).
  */
 #define APP_DATA_BUF_NMBR        8
 
+#if APP_ADC_MODE != APP_ADC_MODE_STREAM && APP_ADC_MODE != APP_ADC_MODE_CAPTURE && \
+    APP_DATA_BUF_NMBR > BUFFER_QUEUE_MAX
+#error "APP_DATA_BUF_NMBR supera BUFFER_QUEUE_MAX, subir BUFFER_QUEUE_MAX al compilar"
+#endif
+
+#if APP_ADC_MODE == APP_ADC_MODE_CAPTURE && \
+    APP_CAPTURE_PRE + APP_CAPTURE_POST > APP_DATA_BUF_SIZE * APP_DATA_BUF_NMBR
+#error "La ventana de captura no entra en la memoria de los buffers"
+#endif
+
+
+/**
+ * Datos de cada buffer de muestras para el encabezado APP_BUF_HDR en
+ * APP_ADC_MODE_POLL, con DMA estan en adc_dma (adc_dma_buf_info).  Se guardan
+ * en un arreglo aparte indexado con buffer_queue_index, asi el buffer queda
+ * solo con muestras.  La marca de tiempo de la primer muestra va en los
+ * metadatos del buffer (ver buffer_queue_set_meta), tambien la usa
+ * APP_FLUSH_MS.
+ */
+typedef struct _app_buf_hdr
+{
+    uint32_t    period_us;
+    uint32_t    dropped;
+    uint16_t    seq;
+}
+app_buf_hdr;
+
+
+/**
+ * Politica de overrun de adc_update y sus contadores, acumulados desde el
+ * arranque.
+ */
+typedef struct _app_overrun
+{
+    volatile int    policy;
+    unsigned        decim_shift;     // Decimacion actual, como log2
+    uint32_t        decim_count;
+
+    uint32_t        dropped_oldest;  // Buffers descartados (DROP_OLDEST)
+    uint32_t        dropped_newest;  // Muestras descartadas (el resto)
+    uint32_t        blocked;         // Veces que se espero un buffer (BLOCK)
+    uint32_t        block_timeouts;  // Esperas que vencieron (BLOCK)
+    uint32_t        decimated;       // Muestras salteadas por decimacion
+}
+app_overrun;
+
 
 /**
  * Estructura que almacena la configuracion de toda la aplicacion.
@@ -68,25 +482,84 @@ typedef struct _app_type
     debouncer_type      button_up;
     debouncer_type      button_down;
     SemaphoreHandle_t   semaphore_config; // Para indicar que hay una configuracion nueva
+    StaticSemaphore_t   semaphore_config_static;
     config_data         config;
     bool                config_sd_present;
 
     // Indicacion de error para LED
     SemaphoreHandle_t   semaphore_error;
+    StaticSemaphore_t   semaphore_error_static;
 
     // Indicacion de espera de respuesta por Bluetooth
     SemaphoreHandle_t   semaphore_reply;
+    StaticSemaphore_t   semaphore_reply_static;
 
     // Para la tarea que envia datos por la Bluetooth
     float               accel[3];
 
     // Para la tarea del ADC
     buffer_queue        data_queue;
-    unsigned            samples_in_buffer;
+    unsigned            samples_in_buffer; // En bytes si APP_ADC_BITS == 10
+    uint16_t            pack[PACK10_GROUP];
+    unsigned            n_pack;
+    frontend_type       frontend;
+    uint16_t            frontend_out;  // Ultima salida del decimador
     uint8_t*            current_buffer;
+    app_buf_hdr         buf_hdr[APP_DATA_BUF_NMBR]; // Escribe el ADC, lee APP
+    uint16_t            buf_seq;      // Proximo numero de secuencia
+    app_overrun         overrun;
+#if APP_SINK_UART
+    int                 sink_uart;    // Consumidor del buffer_queue de vTaskSinkUart
+#endif
+
+    // Procesamiento de las muestras, lo usa la tarea APP
+    calib_type          calib;
+    calib_channel       calib_new[CALIB_N_CHANNELS]; // Lo carga la tarea de configuracion
+    SemaphoreHandle_t   semaphore_calib;  // Para indicar que hay una calibracion nueva
+    StaticSemaphore_t   semaphore_calib_static;
+    filter_type         filter;
+    filter_type         filter_new;        // Lo carga la tarea de configuracion
+    SemaphoreHandle_t   semaphore_filter;  // Para indicar que hay un filtro nuevo
+    StaticSemaphore_t   semaphore_filter_static;
+    resample_type       resample;
+    unsigned            resample_period;   // sample_period de la relacion actual
+#if APP_PROC_MODE == APP_PROC_FFT
+    spectrum_type       spectrum;
+    uint16_t            spectrum_out[SPECTRUM_MAX_SIZE / 2];
+#endif
+    summary_type        summary;
+    events_type         events;
+#if APP_PROC_MODE == APP_PROC_CODEC
+    uint8_t             codec_in[APP_CODEC_BLOCK];
+    uint8_t             codec_out[CODEC_MAX_SIZE(APP_CODEC_BLOCK)];
+    unsigned            codec_n;
+#endif
+#if APP_PROC_MODE == APP_PROC_EVENTS
+    event_record        events_recs[APP_EVENTS_MAX];
+    uint8_t             events_out[APP_EVENTS_MAX * EVENTS_RECORD_SIZE];
+#endif
+#if APP_PROC_MODE == APP_PROC_GOERTZEL
+    goertzel_type       goertzel;
+    goertzel_tones      goertzel_new;       // Lo carga la tarea de configuracion
+    SemaphoreHandle_t   semaphore_tones;    // Para indicar que hay tonos nuevos
+    StaticSemaphore_t   semaphore_tones_static;
+    uint32_t            goertzel_period_us; // Periodo de los coeficientes actuales
+#endif
+
+    // Regulador del periodo de muestreo, lo usa la tarea APP
+    governor_type       governor;
+    uint32_t            governor_losses;  // Perdidas vistas en la ultima evaluacion
+    unsigned            governor_period;  // Periodo elegido, lo lee la tarea del ADC
+    unsigned            governor_keys;    // config.sample_period visto por ultima vez
+    adc_dma_type        adc_dma;
+    adc_stream_type     adc_stream;  // Sin tarea del ADC, la lee vTaskApp
+    capture_type        capture;     // Sin tarea del ADC, la lee vTaskApp
+    tstamp_jitter       jitter;
 
     // FIFO para los nuevos valores leidos del MPU
     QueueHandle_t       queue_mpu;
+    StaticQueue_t       queue_mpu_static;
+    uint8_t             queue_mpu_mem[sizeof(float[3])];
 }
 app_type;
 
@@ -101,6 +574,25 @@ app_type;
  */
 void app_init( app_type* app );
 
+/**
+ * Cambia la politica de overrun de adc_update (APP_OVERRUN_*).  Los contadores
+ * no se reinician.
+ */
+void app_set_overrun_policy( app_type* app, int policy );
+
+/**
+ * Copia la politica y los contadores de overrun en 'out'.  Se puede llamar
+ * desde cualquier tarea.
+ */
+void app_get_overrun( app_type* app, app_overrun* out );
+
+/**
+ * Pide remuestrear la salida por up/down (ver resample_set_ratio), se toma
+ * entre buffers sin saltos.  Se puede llamar desde cualquier tarea.  Devuelve
+ * -1 si la relacion no esta soportada o si no se usa APP_RESAMPLE_USED.
+ */
+int  app_set_resample_ratio( app_type* app, unsigned up, unsigned down );
+
 
 #ifdef __cplusplus
 }
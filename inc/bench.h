@@ -0,0 +1,79 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Mediciones de rendimiento en la placa, con el contador de ciclos del DWT.
+ * Los resultados se imprimen por la UART de mensajes.  Se corren una vez al
+ * arrancar si APP_BENCH esta en 1.
+ */
+
+/// Senales de prueba para los benchmarks.
+#define BENCH_SIGNAL_SLOW   0  /// Seno lento de baja amplitud con ruido de 1 cuenta.
+#define BENCH_SIGNAL_RAMP   1  /// Rampa lenta.
+#define BENCH_SIGNAL_STEP   2  /// Cuadrada, escalones grandes poco frecuentes.
+#define BENCH_SIGNAL_NOISE  3  /// Ruido blanco en todo el rango.
+#define BENCH_N_SIGNALS     4
+
+
+/**
+ * Habilita el contador de ciclos.
+ */
+void     bench_init  ( void );
+
+/**
+ * Ciclos de CPU desde bench_init, da la vuelta cada 2^32.
+ */
+uint32_t bench_cycles( void );
+
+/**
+ * Llena 'out' con 'n' muestras de la senal 'signal' (BENCH_SIGNAL_*).
+ */
+void     bench_signal( unsigned signal, uint8_t* out, unsigned n );
+
+/**
+ * Compresion y ciclos por muestra de cada codec (ver codec.h) sobre bloques de
+ * 'block' muestras de cada senal de prueba.  Verifica que los codecs sin
+ * perdida decodifiquen exacto e informa el error maximo de ADPCM.
+ */
+void     bench_codec ( unsigned block );
+
+/**
+ * Ciclos por buffer de 'n' muestras del escalado de app_update: el lazo
+ * original con un producto float por muestra contra scale_apply.
+ */
+void     bench_scale ( unsigned n );
+
+/**
+ * Ciclos de un bloque de 'size' muestras (potencia de 2, ver spectrum_init)
+ * con el banco de Goertzel de 'n_tones' tonos contra el espectro completo de
+ * spectrum.h.  El espectro solo se mide con SPECTRUM_USED, que es cuando se
+ * compila con CMSIS-DSP.
+ */
+void     bench_goertzel( unsigned size, unsigned n_tones );
+
+/**
+ * Operaciones por segundo de agregar y sacar un buffer, 'n' veces, con el
+ * anillo de indices de index_ring.h contra una cola de FreeRTOS de punteros
+ * (las dos implementaciones de buffer_queue.h).  La misma medicion en la PC,
+ * sobre buffer_queue completo, es 'make -C host bench'.
+ */
+void     bench_buffer_queue( unsigned n );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
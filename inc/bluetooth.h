@@ -18,6 +18,7 @@ extern "C" {
 
 int  bluetooth_init( void );
 void bluetooth_write( uint8_t data );
+void bluetooth_write_buf( const uint8_t* data, unsigned n );
 bool bluetooth_read( uint8_t* data );
 
 #ifdef __cplusplus
@@ -11,6 +11,8 @@
 #include <FreeRTOS.h>
 #include <queue.h>
 #include <stdint.h>
+#include <stdbool.h>
+#include "index_ring.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -35,15 +37,97 @@ extern "C" {
  *      metodos de _push y _return no pueden fallar, porque como la cantidad de
  *      buffers es acotada (determinada en el arranque) cuando se lo saca de los
  *      en uso sabemos que tiene que haber lugar en los vacios y viceversa.
+ * Con BUFFER_QUEUE_RING en 1 las dos FIFOs son anillos de indices sin bloqueo
+ * (ver index_ring.h) en vez de colas de FreeRTOS: sacar y poner un buffer no
+ * copia, no entra en seccion critica ni pasa por el scheduler, y solo se
+ * espera en el semaforo del anillo cuando esta vacio.  La interfaz es la
+ * misma.
+ * Cada buffer tiene ademas un largo y una ranura de metadatos de 32 bits,
+ * que escribe el que lo llena y lee el que lo procesa.  Con
+ * buffer_queue_push el largo es 'size'; con buffer_queue_push_partial se
+ * puede entregar un buffer a medio llenar, por ejemplo para no demorar las
+ * muestras cuando la tasa es baja.  Hay hasta BUFFER_QUEUE_MAX buffers.
+ * Todo lo que usa esta en la estructura y en 'mem', no se pide nada al heap,
+ * asi que con ambas estaticas la memoria queda fija al linkear.
+ * Un buffer lleno puede ir a varios consumidores sin copiarlo: cada uno
+ * registrado con buffer_queue_add_consumer tiene su propia lista de buffers
+ * en uso y al hacer push el buffer se coloca en todas, con una cuenta de
+ * referencias.  Cada consumidor lo saca con buffer_queue_get_inuse_by y lo
+ * devuelve con buffer_queue_return; recien cuando lo devuelve el ultimo
+ * vuelve a la lista de disponibles.  Mientras esta compartido el buffer es
+ * de solo lectura.  El consumidor 0 lo crea buffer_queue_init y es el que
+ * usan buffer_queue_get_inuse y buffer_queue_inuse_count.
  */
 
+/// 1: anillos de indices sin bloqueo, 0: colas de FreeRTOS.
+#ifndef BUFFER_QUEUE_RING
+#define BUFFER_QUEUE_RING   0
+#endif
+
+/**
+ * Buffers maximos, dimensiona los arreglos por buffer y las colas.  Se puede
+ * cambiar al compilar; los indices son de 8 bits, asi que hasta 255, y con
+ * BUFFER_QUEUE_RING hasta INDEX_RING_MAX.
+ */
+#ifndef BUFFER_QUEUE_MAX
+#define BUFFER_QUEUE_MAX    16
+#endif
+
+#if BUFFER_QUEUE_MAX < 1 || BUFFER_QUEUE_MAX > 255
+#error "BUFFER_QUEUE_MAX tiene que estar entre 1 y 255"
+#endif
+#if BUFFER_QUEUE_RING && BUFFER_QUEUE_MAX > INDEX_RING_MAX
+#error "Con BUFFER_QUEUE_RING, BUFFER_QUEUE_MAX no puede superar INDEX_RING_MAX"
+#endif
+
+/// Consumidores maximos, contando el 0.
+#define BUFFER_QUEUE_CONSUMERS_MAX  3
+
+/**
+ * Una lista de indices de buffers.  Con colas de FreeRTOS la memoria de la
+ * cola va adentro, asi buffer_queue no usa el heap en ninguna de las dos
+ * implementaciones.
+ */
+#if BUFFER_QUEUE_RING
+typedef index_ring buffer_queue_list;
+#else
+typedef struct _buffer_queue_list
+{
+    QueueHandle_t   handle;
+    StaticQueue_t   queue;
+    uint8_t         mem[BUFFER_QUEUE_MAX];
+}
+buffer_queue_list;
+#endif
+
+/**
+ * Estadisticas de un consumidor.  El atraso es cuantos buffers tenia
+ * pendientes al sacar uno (contando ese) y la edad cuanto espero el buffer
+ * desde el push, en ticks.  Las escribe solo el consumidor al sacar, los
+ * descartes de buffer_queue_drop_oldest no cuentan.
+ */
+typedef struct _buffer_queue_stats
+{
+    uint32_t    taken;      // Buffers sacados
+    uint32_t    lag_max;    // Atraso maximo
+    uint32_t    age_max;    // Edad maxima
+    uint32_t    age_sum;    // Suma de edades, para el promedio
+}
+buffer_queue_stats;
+
 typedef struct _buffer_queue
 {
-    QueueHandle_t   avail;
-    QueueHandle_t   inuse;
+    buffer_queue_list avail;
+    buffer_queue_list inuse[BUFFER_QUEUE_CONSUMERS_MAX];
     uint8_t*        mem; // Of size * n_elems
     unsigned        size;
     unsigned        n_elems;
+    unsigned        n_consumers;
+    uint16_t        len[BUFFER_QUEUE_MAX];   // Bytes validos de cada buffer
+    uint32_t        meta[BUFFER_QUEUE_MAX];  // Metadatos de cada buffer
+    uint8_t volatile refs[BUFFER_QUEUE_MAX]; // Consumidores que aun lo tienen
+    TickType_t      pushed[BUFFER_QUEUE_MAX]; // Tick del push
+    buffer_queue_stats stats[BUFFER_QUEUE_CONSUMERS_MAX];
 }
 buffer_queue;
 
@@ -57,6 +141,12 @@ buffer_queue;
  */
 int      buffer_queue_init     ( buffer_queue* bq, uint8_t* mem, unsigned size, unsigned n );
 
+/**
+ * Agrega un consumidor y retorna su numero, o -1 si no hay lugar.  Se llama
+ * antes del primer push: los buffers entregados antes no le llegan.
+ */
+int      buffer_queue_add_consumer( buffer_queue* bq );
+
 /**
  * Obtener un buffer disponible.  NULL de no ser posible.
  */
@@ -67,16 +157,85 @@ uint8_t* buffer_queue_get_avail( buffer_queue* bq, TickType_t xTicksToWait );
  */
 void     buffer_queue_push     ( buffer_queue* bq, uint8_t* buf );
 
+/**
+ * Enviar a la lista de buffers llenos un buffer con solo 'len' bytes validos.
+ */
+void     buffer_queue_push_partial( buffer_queue* bq, uint8_t* buf, unsigned len );
+
 /**
  * Obtener un buffer lleno.  NULL de no ser posible.
  */
 uint8_t* buffer_queue_get_inuse( buffer_queue* bq, TickType_t xTicksToWait );
 
 /**
- * Devolver un buffer a la lista de disponibles.
+ * Obtener un buffer lleno de la lista del consumidor 'consumer'.
+ */
+uint8_t* buffer_queue_get_inuse_by( buffer_queue* bq, unsigned consumer, TickType_t xTicksToWait );
+
+/**
+ * Devolver un buffer.  Vuelve a la lista de disponibles cuando lo devolvieron
+ * todos los consumidores, o enseguida si nunca se entrego.
  */
 void     buffer_queue_return   ( buffer_queue* bq, uint8_t* buf );
 
+/**
+ * Descarta el buffer lleno mas viejo del consumidor 0, para reutilizarlo en
+ * un overrun.  Es como sacarlo y devolverlo, pero no cuenta en las
+ * estadisticas.  Devuelve false si no habia ninguno.
+ */
+bool     buffer_queue_drop_oldest( buffer_queue* bq );
+
+/**
+ * Variantes para usar desde una interrupcion, por ejemplo un DMA que llena o
+ * vacia buffers sin una tarea en el medio.  No esperan: si no hay buffer
+ * devuelven NULL.  Si al agregar a una lista despiertan a una tarea de mayor
+ * prioridad ponen *pxHigherPriorityTaskWoken en pdTRUE, para terminar la
+ * interrupcion con portYIELD_FROM_ISR.  La interrupcion tiene que tener una
+ * prioridad que permita llamar a la API de FreeRTOS
+ * (configMAX_SYSCALL_INTERRUPT_PRIORITY).
+ */
+uint8_t* buffer_queue_get_avail_from_isr( buffer_queue* bq, BaseType_t* pxHigherPriorityTaskWoken );
+void     buffer_queue_push_from_isr( buffer_queue* bq, uint8_t* buf, BaseType_t* pxHigherPriorityTaskWoken );
+void     buffer_queue_push_partial_from_isr( buffer_queue* bq, uint8_t* buf, unsigned len, BaseType_t* pxHigherPriorityTaskWoken );
+uint8_t* buffer_queue_get_inuse_from_isr( buffer_queue* bq, BaseType_t* pxHigherPriorityTaskWoken );
+uint8_t* buffer_queue_get_inuse_by_from_isr( buffer_queue* bq, unsigned consumer, BaseType_t* pxHigherPriorityTaskWoken );
+void     buffer_queue_return_from_isr( buffer_queue* bq, uint8_t* buf, BaseType_t* pxHigherPriorityTaskWoken );
+bool     buffer_queue_drop_oldest_from_isr( buffer_queue* bq, BaseType_t* pxHigherPriorityTaskWoken );
+
+/**
+ * Cantidad de buffers disponibles en este momento.
+ */
+unsigned buffer_queue_avail_count( const buffer_queue* bq );
+
+/**
+ * Cantidad de buffers llenos esperando ser procesados.
+ */
+unsigned buffer_queue_inuse_count( const buffer_queue* bq );
+unsigned buffer_queue_inuse_count_by( const buffer_queue* bq, unsigned consumer );
+
+/**
+ * Copia las estadisticas del consumidor 'consumer'.
+ */
+void     buffer_queue_get_stats( const buffer_queue* bq, unsigned consumer, buffer_queue_stats* out );
+
+/**
+ * Bytes validos de un buffer lleno, 0 si no es de esta lista.
+ */
+unsigned buffer_queue_len      ( const buffer_queue* bq, const uint8_t* buf );
+
+/**
+ * Escribe y lee los metadatos de un buffer.  Los escribe el que tiene el
+ * buffer, antes de entregarlo.
+ */
+void     buffer_queue_set_meta ( buffer_queue* bq, const uint8_t* buf, uint32_t meta );
+uint32_t buffer_queue_get_meta ( const buffer_queue* bq, const uint8_t* buf );
+
+/**
+ * Posicion de 'buf' dentro de la memoria, de 0 a n-1.  Sirve para guardar
+ * datos de cada buffer en un arreglo aparte.  -1 si no es de esta lista.
+ */
+int      buffer_queue_index    ( const buffer_queue* bq, const uint8_t* buf );
+
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,99 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __CALIB_H__
+#define __CALIB_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Calibracion por canal de las muestras de 8 bits.  Para cada canal:
+ *   1. v = (x + offset) * gain, con offset en cuentas Q8.8 y gain en Q4.12.
+ *   2. Opcionalmente una correccion lineal por tramos que pasa por los puntos
+ *      (px[i], py[i]), con px creciente; fuera de los puntos se extiende el
+ *      tramo de la punta.
+ *   3. Redondeo y saturacion a 0..255.
+ * calib_eval es la implementacion de referencia, en C portable y sin tablas,
+ * para comparar con lo que calcule el host.  Para aplicarla rapido se arma con
+ * ella una tabla de 256 entradas por canal y calib_apply pasa el buffer por la
+ * tabla en el lugar, de a 4 muestras por palabra.
+ * Formato del archivo, un registro por canal, little endian:
+ *   [0]     canal (0 a CALIB_N_CHANNELS-1).
+ *   [1]     cantidad N de puntos de la correccion, 0 o de 2 a CALIB_POINTS_MAX.
+ *   [2..3]  offset, Q8.8 con signo.
+ *   [4..5]  gain, Q4.12 sin signo.
+ *   [6..]   N pares (px, py) de un byte cada uno.
+ * Los canales sin registro quedan sin calibrar.
+ */
+
+#define CALIB_N_CHANNELS    8
+#define CALIB_POINTS_MAX    8
+/// Ganancia 1 en Q4.12.
+#define CALIB_GAIN_ONE      4096
+/// Tamano maximo del archivo de calibracion.
+#define CALIB_FILE_MAX      (CALIB_N_CHANNELS * (6 + 2 * CALIB_POINTS_MAX))
+
+
+typedef struct _calib_channel
+{
+    int16_t     offset;
+    uint16_t    gain;
+    uint8_t     n_points;
+    uint8_t     px[CALIB_POINTS_MAX];
+    uint8_t     py[CALIB_POINTS_MAX];
+}
+calib_channel;
+
+typedef struct _calib_type
+{
+    uint8_t     lut[CALIB_N_CHANNELS][256];
+}
+calib_type;
+
+
+/**
+ * Deja los CALIB_N_CHANNELS canales de 'ch' sin calibrar.
+ */
+void    calib_default( calib_channel* ch );
+
+/**
+ * Carga los CALIB_N_CHANNELS canales de 'ch' desde los 'n' bytes del archivo.
+ * Devuelve la cantidad de canales cargados o -1 si el formato es invalido, en
+ * tal caso quedan todos sin calibrar.
+ */
+int     calib_parse  ( calib_channel* ch, const uint8_t* data, unsigned n );
+
+/**
+ * Referencia: valor calibrado de la muestra 'x'.
+ */
+uint8_t calib_eval   ( const calib_channel* c, uint8_t x );
+
+/**
+ * Arma las tablas de los CALIB_N_CHANNELS canales de 'ch'.
+ */
+void    calib_build  ( calib_type* cal, const calib_channel* ch );
+
+/**
+ * Calibra en el lugar 'n' muestras del canal 'chn'.
+ */
+void    calib_apply  ( const calib_type* cal, unsigned chn, uint8_t* buf, unsigned n );
+
+/**
+ * Calibra en el lugar 'n' muestras de barridos intercalados de los canales de
+ * 'mask', en orden ascendente de canal como en adc_scan_start.
+ */
+void    calib_apply_scan( const calib_type* cal, uint8_t mask, uint8_t* buf, unsigned n );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
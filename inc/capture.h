@@ -0,0 +1,110 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Captura con pretrigger sobre el ADC0.  Funciona de la siguiente manera:
+ *   1. El TIMER0 dispara el ADC y la interrupcion de fin de conversion guarda
+ *      cada muestra de 8 bits en un buffer circular de 'pre' + 'post' muestras.
+ *   2. Una vez que hay al menos 'pre' muestras de historia se evalua el
+ *      disparo en cada muestra: cruce del nivel 'level' en el sentido 'edge',
+ *      con un salto entre muestras de al menos 'slope_min'.
+ *   3. La muestra del disparo es la primera de las 'post' que se siguen
+ *      guardando.  Al completarlas la captura se detiene y se despierta a la
+ *      tarea que llamo a capture_start.
+ *   4. capture_wait deja la ventana ordenada en el tiempo al principio de la
+ *      memoria; una vez enviada, capture_rearm vuelve a empezar.
+ * Mientras la ventana espera a ser enviada no se muestrea.
+ */
+
+/// Sentido del cruce de nivel.
+#define CAPTURE_RISING      0
+#define CAPTURE_FALLING     1
+#define CAPTURE_BOTH        2
+
+/// Estados de la captura.
+#define CAPTURE_ARMED       0  /// Llenando la historia y buscando el disparo.
+#define CAPTURE_POST        1  /// Disparada, llenando la ventana posterior.
+#define CAPTURE_DONE        2  /// Ventana completa, esperando a la tarea.
+
+
+typedef struct _capture_type
+{
+    uint8_t*            mem;
+    unsigned            pre;
+    unsigned            post;
+    TaskHandle_t        task;
+
+    // Disparo
+    uint8_t             level;
+    uint8_t             edge;
+    uint8_t             slope_min;
+
+    // Compartidos con la interrupcion
+    volatile uint8_t    state;
+    unsigned            idx;        // Proxima posicion a escribir
+    unsigned            filled;     // Muestras de historia, hasta 'pre'
+    unsigned            remaining;  // Muestras que faltan despues del disparo
+    uint8_t             prev;
+    uint32_t            trig_tstamp;
+    volatile unsigned   triggers;   // Capturas completas
+}
+capture_type;
+
+
+/**
+ * Inicializa la captura sobre 'mem', que debe tener lugar para 'pre' + 'post'
+ * muestras y persistir.  Devuelve -1 si no entra o si 'post' es 0.
+ */
+int      capture_init       ( capture_type* cap, uint8_t* mem, unsigned mem_size,
+                              unsigned pre, unsigned post );
+
+/**
+ * Configura el disparo: nivel, sentido (CAPTURE_*) y salto minimo entre la
+ * muestra anterior y la del disparo (0 para cualquiera).
+ */
+void     capture_set_trigger( capture_type* cap, uint8_t level, uint8_t edge, uint8_t slope_min );
+
+/**
+ * Procesa una muestra tomada en 'now' (tstamp).  Devuelve true cuando se
+ * completa la ventana.  La llama la interrupcion del ADC.
+ */
+bool     capture_push       ( capture_type* cap, uint8_t sample, uint32_t now );
+
+/**
+ * Arranca (o reprograma) el muestreo del canal 'chn', una muestra cada
+ * 'period_us'.  Llamar desde la tarea que despues llama a capture_wait.
+ */
+void     capture_start      ( capture_type* cap, int chn, uint32_t period_us );
+
+/**
+ * Espera como maximo 'xTicksToWait' una ventana completa.  Devuelve la
+ * ventana de 'pre' + 'post' muestras en orden, o NULL si no hubo disparo.
+ */
+uint8_t* capture_wait       ( capture_type* cap, TickType_t xTicksToWait );
+
+/**
+ * Descarta la historia y vuelve a buscar el disparo.
+ */
+void     capture_rearm      ( capture_type* cap );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,63 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __CIC_H__
+#define __CIC_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Decimador CIC en punto fijo: 'order' integradores a la tasa de entrada,
+ * diezmado por R = 2^log2_ratio y 'order' peines a la tasa de salida.  Con
+ * order == 1 es un promedio movil (boxcar) de R muestras.
+ * La ganancia es R^order, o sea que crece order*log2_ratio bits.  Todo se hace
+ * en aritmetica modular de 32 bits, que da el resultado exacto siempre que
+ * in_bits + order*log2_ratio <= 32, aunque los integradores desborden.
+ * La salida se reescala a 'out_bits': si out_bits > in_bits se ganan bits de
+ * resolucion efectiva del ruido promediado.
+ */
+
+/// Orden maximo del filtro.
+#define CIC_MAX_ORDER   4
+
+
+typedef struct _cic_type
+{
+    unsigned    order;
+    unsigned    log2_ratio;
+    unsigned    shift;      // Bits que se descartan a la salida
+    uint32_t    out_max;    // Saturacion de la salida
+    uint32_t    integ[CIC_MAX_ORDER];
+    uint32_t    comb[CIC_MAX_ORDER];  // Entrada anterior de cada peine
+    unsigned    phase;      // Muestras desde la ultima salida
+}
+cic_type;
+
+
+/**
+ * Inicializa el filtro.  Devuelve -1 si los parametros no entran en 32 bits o
+ * si se pide mas resolucion de la que da la ganancia del filtro.
+ */
+int  cic_init( cic_type* cic, unsigned order, unsigned log2_ratio,
+               unsigned in_bits, unsigned out_bits );
+
+/**
+ * Pasa una muestra de entrada.  Cada R muestras deja una salida en 'out' y
+ * devuelve true.
+ */
+bool cic_push( cic_type* cic, uint16_t in, uint16_t* out );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,62 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __CODEC_H__
+#define __CODEC_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Compresion de bloques de muestras de 8 bits para mandar por el enlace.
+ * Cada bloque se codifica solo, sin estado entre bloques, para que perder uno
+ * no arruine los siguientes.  Formato de cada bloque, little endian:
+ *   [0]    codec (CODEC_*).
+ *   [1..2] cantidad N de muestras.
+ *   [3]    parametro del codec (k de Rice, indice inicial de ADPCM).
+ *   [4]    primer muestra, tal cual.
+ *   [5..6] bytes de datos que siguen.
+ *   [7..]  las N-1 muestras restantes codificadas.
+ * Rice usa la diferencia con la muestra anterior modulo 256 (entre -128 y 127)
+ * pasada a zig-zag (0, -1, 1, -2, ... -> 0, 1, 2, 3, ...): con q = u >> k van
+ * q unos, un cero y los k bits bajos, o 8 unos y los 8 bits si q es
+ * grande.  Con muestras de 8 bits un varint nunca ocupa menos de un byte por
+ * muestra, por eso no hay.
+ * Si un codec ocupa mas que las muestras crudas se usa CODEC_RAW.
+ */
+
+#define CODEC_RAW       0  /// Muestras crudas.
+#define CODEC_RICE      1  /// Zig-zag en Rice con el k optimo del bloque.  Sin perdida.
+#define CODEC_ADPCM     2  /// IMA ADPCM de 4 bits por muestra.  Con perdida.
+
+/// Bytes del encabezado de cada bloque.
+#define CODEC_HDR_SIZE  7
+/// Tamano maximo de un bloque codificado de 'n' muestras.
+#define CODEC_MAX_SIZE(n)   (CODEC_HDR_SIZE + 2 * (n))
+
+
+/**
+ * Codifica las 'n' muestras de 'in' (1 a 65535) en 'out', que debe tener
+ * CODEC_MAX_SIZE(n) bytes.  Devuelve los bytes escritos.
+ */
+unsigned codec_encode( uint8_t codec, const uint8_t* in, unsigned n, uint8_t* out );
+
+/**
+ * Decodificador de referencia: decodifica el bloque de 'len' bytes en 'out',
+ * de hasta 'max' muestras.  Devuelve la cantidad de muestras o -1 si el
+ * bloque esta mal formado.
+ */
+int      codec_decode( const uint8_t* in, unsigned len, uint8_t* out, unsigned max );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
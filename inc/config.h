@@ -8,23 +8,40 @@
 #ifndef __CONFIG_H__
 #define __CONFIG_H__
 
+#include <stdint.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 
 #define CONFIG_DEFAULT_SAMPLE_PERIOD    0
+#define CONFIG_DEFAULT_SAMPLE_PERIOD_US 1000
 
 
+/**
+ * En el archivo se guarda primero 'sample_period' (1 byte) y despues el resto
+ * de los campos en little endian.  Si el archivo es de una version anterior y
+ * no tiene algun campo se usa el valor por defecto.
+ */
 typedef struct _config_data
 {
     unsigned    sample_period;
+    uint32_t    sample_period_us;  // Periodo de muestreo por timer, en us
 }
 config_data;
 
 
-int config_init( const char* filename, config_data* cfg );
-int config_write( const char* filename, const config_data* cfg );
+void config_default( config_data* cfg );
+int  config_init( const char* filename, config_data* cfg );
+int  config_write( const char* filename, const config_data* cfg );
+
+/**
+ * Lee hasta 'max' bytes de otro archivo de la SD, que ya tiene que estar
+ * montada por config_init.  Devuelve los bytes leidos o -1 si no se pudo abrir
+ * o leer.
+ */
+int  config_read_file( const char* filename, uint8_t* data, unsigned max );
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,112 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __EVENTS_H__
+#define __EVENTS_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Detector de eventos sobre un flujo de muestras de 8 bits, para mandar solo
+ * lo que pasa en vez de todas las muestras.  El estado se mantiene entre
+ * llamadas, asi que un evento puede empezar en un buffer y terminar en otro.
+ *   * Picos: maximos y minimos locales que se alejan al menos 'prominence' del
+ *     extremo anterior.  Se informan recien cuando la senal se alejo
+ *     'prominence' del pico, con el indice y el valor del pico.
+ *   * Cruces: la senal pasa 'level' hacia arriba o hacia abajo, con una
+ *     histeresis de 'hyst' para no informar el ruido alrededor del nivel.
+ *   * Rachas: 'min_run' o mas muestras seguidas por encima de 'hi' o por
+ *     debajo de 'lo'.  Se informan al terminar, con el indice de la primera
+ *     muestra, el valor mas alejado y el largo.
+ * El indice de cada evento cuenta muestras desde events_init, con el periodo
+ * de muestreo se pasa a tiempo.  Los eventos salen en el orden en que se
+ * detectan, que no es siempre el de sus indices.
+ */
+
+#define EVENT_MAX           1
+#define EVENT_MIN           2
+#define EVENT_CROSS_UP      3
+#define EVENT_CROSS_DOWN    4
+#define EVENT_RUN_HIGH      5
+#define EVENT_RUN_LOW       6
+
+/// Eventos que puede generar una sola muestra.
+#define EVENTS_PER_SAMPLE   3
+/// Bytes de cada registro codificado con events_encode.
+#define EVENTS_RECORD_SIZE  8
+
+
+typedef struct _event_record
+{
+    uint32_t    index;
+    uint8_t     type;
+    uint8_t     value;
+    uint16_t    length;     // Muestras de la racha, 0 en los demas
+}
+event_record;
+
+typedef struct _events_type
+{
+    // Parametros
+    uint8_t     prominence;
+    uint8_t     level;
+    uint8_t     hyst;
+    uint8_t     lo;
+    uint8_t     hi;
+    uint16_t    min_run;
+
+    uint32_t    index;          // Indice de la proxima muestra
+
+    // Picos: se busca un maximo o un minimo
+    bool        peak_valid;
+    bool        seek_max;
+    uint8_t     peak;
+    uint32_t    peak_index;
+
+    // Cruces: 1 arriba del nivel, -1 abajo, 0 todavia no se sabe
+    int8_t      side;
+
+    // Rachas: 1 arriba de 'hi', -1 abajo de 'lo', 0 ninguna
+    int8_t      run;
+    uint8_t     run_value;
+    uint32_t    run_index;
+}
+events_type;
+
+
+/**
+ * Inicializa el detector con sus parametros.  Devuelve -1 si no tienen
+ * sentido ('prominence' 0, 'lo' > 'hi' o 'min_run' 0), en tal caso el
+ * detector no genera eventos.
+ */
+int      events_init  ( events_type* ev, uint8_t prominence, uint8_t level, uint8_t hyst,
+                        uint8_t lo, uint8_t hi, uint16_t min_run );
+
+/**
+ * Procesa muestras de 'samples' hasta 'n' o hasta que no entren mas eventos
+ * en 'out', que tiene lugar para 'max'.  Devuelve cuantas muestras uso y deja
+ * en 'n_out' cuantos eventos genero.  Hay que volver a llamar con el resto.
+ */
+unsigned events_push  ( events_type* ev, const uint8_t* samples, unsigned n,
+                        event_record* out, unsigned max, unsigned* n_out );
+
+/**
+ * Codifica el evento en EVENTS_RECORD_SIZE bytes, little endian:
+ *   [0..3] indice, [4] tipo (EVENT_*), [5] valor, [6..7] largo.
+ */
+void     events_encode( const event_record* rec, uint8_t* out );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,87 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __FILTER_H__
+#define __FILTER_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Filtro en punto fijo para muestras de 8 bits, FIR o cascada de biquads,
+ * seguido de un diezmado opcional.  Se aplica sobre el mismo buffer y el
+ * estado se mantiene entre buffers, asi que una secuencia de buffers se
+ * filtra igual que si fuera uno solo.  Las muestras se centran en 128 antes
+ * de filtrar y la salida se satura a 0..255.
+ *   * FIR: y = sum(h[k] * x[n-k]), h en Q15.  Con diezmado solo se calculan
+ *     las salidas que quedan.
+ *   * Biquad: por etapa y = b0*x + b1*x1 + b2*x2 - a1*y1 - a2*y2, en Q14
+ *     (con a0 = 1), forma directa I.
+ * El formato del archivo de coeficientes (ver filter_parse), little endian:
+ *   [0]   tipo (FILTER_NONE, FILTER_FIR, FILTER_BIQUAD).
+ *   [1]   cantidad de coeficientes del FIR o de etapas de biquad.
+ *   [2]   diezmado, 1 para no diezmar.
+ *   [3..] coeficientes de 16 bits con signo: los h[k] del FIR, o b0, b1, b2,
+ *         a1, a2 de cada etapa.
+ */
+
+#define FILTER_NONE         0
+#define FILTER_FIR          1
+#define FILTER_BIQUAD       2
+
+/// Coeficientes maximos del FIR.
+#define FILTER_FIR_MAX      32
+/// Etapas maximas de biquad.
+#define FILTER_BIQUAD_MAX   4
+/// Tamano maximo del archivo de coeficientes.
+#define FILTER_FILE_MAX     (3 + 2 * FILTER_FIR_MAX)
+
+
+typedef struct _filter_type
+{
+    uint8_t     type;
+    uint8_t     n;          // Coeficientes del FIR o etapas de biquad
+    uint8_t     decim;
+    uint8_t     phase;      // Muestras desde la ultima que quedo
+    int16_t     coef[FILTER_FIR_MAX > 5 * FILTER_BIQUAD_MAX ? FILTER_FIR_MAX : 5 * FILTER_BIQUAD_MAX];
+
+    // Estado del FIR: linea de retardo duplicada, para leerla sin modulo
+    int16_t     hist[2 * FILTER_FIR_MAX];
+    unsigned    idx;
+
+    // Estado de cada biquad: x1, x2, y1, y2 con 8 bits de fraccion
+    int32_t     iir[FILTER_BIQUAD_MAX][4];
+}
+filter_type;
+
+
+/**
+ * Deja el filtro sin efecto (FILTER_NONE, sin diezmado).
+ */
+void     filter_init ( filter_type* f );
+
+/**
+ * Carga el filtro desde los 'n' bytes de un archivo de coeficientes y
+ * reinicia el estado.  Devuelve -1 si el formato es invalido, en tal caso el
+ * filtro queda sin efecto.
+ */
+int      filter_parse( filter_type* f, const uint8_t* data, unsigned n );
+
+/**
+ * Filtra y diezma las 'n' muestras de 'buf' en el lugar.  Devuelve cuantas
+ * quedaron, al principio de 'buf'.
+ */
+unsigned filter_apply( filter_type* f, uint8_t* buf, unsigned n );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
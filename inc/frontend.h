@@ -0,0 +1,68 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __FRONTEND_H__
+#define __FRONTEND_H__
+
+#include <FreeRTOS.h>
+#include <task.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cic.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Front-end de sobremuestreo para el ADC0.  Funciona de la siguiente manera:
+ *   1. El TIMER0 dispara el ADC a R veces la tasa de salida pedida.
+ *   2. La interrupcion de fin de conversion pasa cada muestra de 10 bits por
+ *      un decimador CIC (ver cic.h).
+ *   3. Cada R muestras queda una salida a la tasa pedida y se despierta a la
+ *      tarea que llamo a frontend_start, que la toma con frontend_read.
+ * Si la tarea no tomo la salida anterior a tiempo se pisa y se cuenta un
+ * overrun.
+ */
+
+typedef struct _frontend_type
+{
+    cic_type            cic;
+    TaskHandle_t        task;
+
+    // Compartidos con la interrupcion
+    volatile uint16_t   out;
+    volatile bool       ready;
+    volatile unsigned   overruns;
+}
+frontend_type;
+
+
+/**
+ * Inicializa el decimador: filtro de orden 'order', R = 2^log2_ratio y salida
+ * de 'out_bits' bits.  Devuelve -1 si el CIC no admite esos parametros.
+ */
+int  frontend_init ( frontend_type* fe, unsigned order, unsigned log2_ratio, unsigned out_bits );
+
+/**
+ * Arranca (o reprograma) el muestreo del canal 'chn' para que salga una
+ * muestra cada 'out_period_us'.  Llamar desde la tarea que despues llama a
+ * frontend_read.
+ */
+void frontend_start( frontend_type* fe, int chn, uint32_t out_period_us );
+
+/**
+ * Espera como maximo 'xTicksToWait' la proxima salida del decimador.
+ */
+bool frontend_read ( frontend_type* fe, uint16_t* out, TickType_t xTicksToWait );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
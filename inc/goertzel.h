@@ -0,0 +1,94 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __GOERTZEL_H__
+#define __GOERTZEL_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Banco de filtros de Goertzel en punto fijo para medir unas pocas
+ * frecuencias conocidas sobre muestras de 8 bits, en ventanas rectangulares de
+ * 'size' muestras.  Cada tono cuesta un producto por muestra, contra los
+ * log2(size) por muestra de una FFT que calcula todos los bins.  Las
+ * frecuencias no tienen que caer en un bin.
+ * Las muestras se centran en 128.  El estado es de 32 bits y el coeficiente
+ * 2*cos(w) esta en Q30, con el producto en 64 bits (SMULL en el M4).  Al final
+ * de cada ventana se calcula la potencia de cada tono y se informa como la
+ * amplitud en cuentas de un seno de esa frecuencia, en punto fijo 8.8, igual
+ * que los bins de spectrum.h.
+ * El formato del archivo de tonos (ver goertzel_parse), little endian:
+ *   [0]   cantidad N de tonos, de 1 a GOERTZEL_TONES_MAX.
+ *   [1..] N frecuencias de 32 bits en mHz.
+ * Las frecuencias por encima de fs/2 miden su imagen por debajo de fs/2.
+ */
+
+/// Ventana maxima, con la que el estado no desborda para f >= fs / 10000.
+#define GOERTZEL_SIZE_MAX   4096
+/// Tonos maximos del banco.
+#define GOERTZEL_TONES_MAX  8
+/// Tamano maximo del archivo de tonos.
+#define GOERTZEL_FILE_MAX   (1 + 4 * GOERTZEL_TONES_MAX)
+
+
+typedef struct _goertzel_tones
+{
+    uint8_t     n;
+    uint32_t    freq_mhz[GOERTZEL_TONES_MAX];
+}
+goertzel_tones;
+
+typedef struct _goertzel_type
+{
+    unsigned        size;
+    unsigned        n;      // Muestras en la ventana actual
+    goertzel_tones  tones;
+    int32_t         coef[GOERTZEL_TONES_MAX];  // 2*cos(w) en Q30
+    int32_t         s1[GOERTZEL_TONES_MAX];
+    int32_t         s2[GOERTZEL_TONES_MAX];
+}
+goertzel_type;
+
+
+/**
+ * Inicializa sin tonos para ventanas de 'size' muestras (1 a
+ * GOERTZEL_SIZE_MAX).
+ * Devuelve -1 si el tamano no es valido.
+ */
+int      goertzel_init     ( goertzel_type* g, unsigned size );
+
+/**
+ * Carga los tonos desde los 'n' bytes de un archivo de tonos.  Devuelve la
+ * cantidad o -1 si el formato es invalido, en tal caso queda sin tonos.
+ */
+int      goertzel_parse    ( goertzel_tones* t, const uint8_t* data, unsigned n );
+
+/**
+ * Cambia los tonos, o la tasa de muestreo con un periodo de 'period_us', y
+ * vuelve a empezar la ventana.
+ */
+void     goertzel_set_tones( goertzel_type* g, const goertzel_tones* t, uint32_t period_us );
+
+/**
+ * Acumula muestras de 'samples' hasta completar la ventana o hasta 'n'.
+ * Devuelve cuantas uso; si completo la ventana deja la amplitud de cada tono
+ * en 'out', reinicia y pone 'done' en true.  Hay que volver a llamar con el
+ * resto.
+ */
+unsigned goertzel_push     ( goertzel_type* g, const uint8_t* samples, unsigned n,
+                             uint16_t* out, bool* done );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
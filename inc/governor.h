@@ -0,0 +1,103 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __GOVERNOR_H__
+#define __GOVERNOR_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Regulador del periodo de muestreo segun la carga del pipeline.  En cada
+ * evaluacion recibe la ocupacion de la cola (en %), la latencia de la
+ * respuesta Bluetooth y si hubo overruns, y decide si el periodo sube
+ * (muestreo mas lento), baja o queda igual:
+ *   * Un overrun sube el periodo en el momento.
+ *   * Ocupacion >= hi_pct o latencia > latency_max durante 'hold_up'
+ *     evaluaciones seguidas sube el periodo.
+ *   * Ocupacion <= lo_pct con latencia en rango durante 'hold_down'
+ *     evaluaciones seguidas lo baja.
+ * Entre hi_pct y lo_pct no se hace nada, y despues de cada cambio los
+ * contadores arrancan de cero; eso es la histeresis.  Cada decision queda en
+ * un registro circular de GOVERNOR_LOG_SIZE entradas.
+ */
+
+/// Entradas del registro de decisiones.
+#define GOVERNOR_LOG_SIZE   8
+
+/// Motivo de cada decision.
+#define GOVERNOR_OVERRUN    0  /// Hubo overrun, se sube el periodo.
+#define GOVERNOR_BACKLOG    1  /// Cola muy ocupada, se sube el periodo.
+#define GOVERNOR_LATENCY    2  /// Respuesta Bluetooth lenta, se sube el periodo.
+#define GOVERNOR_IDLE       3  /// Sobra capacidad, se baja el periodo.
+
+
+typedef struct _governor_decision
+{
+    uint32_t    time_ms;
+    uint32_t    latency_ms;
+    uint8_t     occupancy;  // En %
+    uint8_t     reason;
+    uint8_t     from;       // Periodo anterior
+    uint8_t     to;         // Periodo nuevo
+}
+governor_decision;
+
+typedef struct _governor_type
+{
+    unsigned    min;
+    unsigned    max;
+    unsigned    hi_pct;
+    unsigned    lo_pct;
+    uint32_t    latency_max;
+    unsigned    hold_up;
+    unsigned    hold_down;
+
+    unsigned    n_up;       // Evaluaciones seguidas pidiendo subir
+    unsigned    n_down;     // Evaluaciones seguidas pidiendo bajar
+
+    governor_decision log[GOVERNOR_LOG_SIZE];
+    unsigned    log_next;
+    unsigned    log_count;  // Total de decisiones tomadas
+}
+governor_type;
+
+
+/**
+ * Inicializa el regulador para periodos entre 'min' y 'max'.
+ */
+void     governor_init  ( governor_type* gov, unsigned min, unsigned max,
+                          unsigned hi_pct, unsigned lo_pct, uint32_t latency_max_ms,
+                          unsigned hold_up, unsigned hold_down );
+
+/**
+ * Evalua el estado del pipeline con el periodo actual 'period' y devuelve el
+ * periodo que hay que usar.  Si cambia agrega la decision al registro.
+ */
+unsigned governor_update( governor_type* gov, unsigned period, unsigned occupancy_pct,
+                          uint32_t latency_ms, bool overrun, uint32_t now_ms );
+
+/**
+ * Ultima decision tomada en 'out'.  Devuelve false si todavia no hubo.
+ */
+bool     governor_last  ( const governor_type* gov, governor_decision* out );
+
+/**
+ * Copia en 'out' hasta 'max' decisiones, de la mas vieja a la mas nueva, y
+ * devuelve cuantas copio.
+ */
+unsigned governor_log   ( const governor_type* gov, governor_decision* out, unsigned max );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
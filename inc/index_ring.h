@@ -0,0 +1,89 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __INDEX_RING_H__
+#define __INDEX_RING_H__
+
+#include <FreeRTOS.h>
+#include <semphr.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Anillo de indices de buffer sin bloqueo, pensado para un productor y un
+ * consumidor.  'tail' solo lo avanza quien agrega y 'head' quien saca, con
+ * operaciones atomicas (LDREX/STREX en el M4), sin secciones criticas ni
+ * pasar por el scheduler.
+ * Cada lugar tiene ademas un numero de secuencia que indica si ya esta
+ * escrito, asi un segundo productor o consumidor ocasional (como el que
+ * descarta el buffer mas viejo en un overrun) toma su lugar con un
+ * compare-and-swap y no rompe nada.  Con uno solo de cada lado el
+ * compare-and-swap sale siempre al primer intento.
+ * Solo el que saca puede esperar: si el anillo esta vacio se duerme en un
+ * semaforo binario propio del anillo y el que agrega lo despierta, solo si hay
+ * alguien esperando.  No se usa la notificacion de la tarea porque FreeRTOS
+ * 10.0 tiene una sola por tarea y la usan frontend.h, capture.h y adc_dma.h.
+ * Desde una interrupcion se agrega con index_ring_push_from_isr y se saca con
+ * index_ring_pop sin espera, que nunca pasa por el scheduler.
+ */
+
+/// Capacidad maxima, potencia de 2.
+#define INDEX_RING_MAX      16
+
+
+typedef struct _index_ring
+{
+    volatile uint32_t   head;   // Proximo a sacar
+    volatile uint32_t   tail;   // Proximo a agregar
+    uint32_t            mask;
+    volatile uint32_t   seq[INDEX_RING_MAX];
+    uint8_t             idx[INDEX_RING_MAX];
+    volatile uint32_t   waiting;   // Hay una tarea esperando que haya algo
+    SemaphoreHandle_t   wake;
+    StaticSemaphore_t   wake_static;
+}
+index_ring;
+
+
+/**
+ * Inicializa vacio, con lugar para al menos 'n' indices.  Devuelve -1 si 'n'
+ * es mayor que INDEX_RING_MAX.
+ */
+int      index_ring_init ( index_ring* r, unsigned n );
+
+/**
+ * Agrega 'idx' y despierta al que espera.  Devuelve false si estaba lleno.
+ */
+bool     index_ring_push ( index_ring* r, uint8_t idx );
+
+/**
+ * Igual que index_ring_push, para usar desde una interrupcion.  Si despierta
+ * una tarea de mayor prioridad pone *pxHigherPriorityTaskWoken en pdTRUE.
+ */
+bool     index_ring_push_from_isr( index_ring* r, uint8_t idx, BaseType_t* pxHigherPriorityTaskWoken );
+
+/**
+ * Saca el indice mas viejo, esperando hasta 'xTicksToWait' si esta vacio.
+ * Devuelve -1 si no hubo ninguno.  Con 'xTicksToWait' en 0 se puede llamar
+ * desde una interrupcion.
+ */
+int      index_ring_pop  ( index_ring* r, TickType_t xTicksToWait );
+
+/**
+ * Cantidad de indices en el anillo en este momento.
+ */
+unsigned index_ring_count( const index_ring* r );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -16,6 +16,12 @@
 void messages_init( int priority );
 void messages_print( const char* msg );
 
+/**
+ * Imprime 'prefix', el valor en decimal y 'suffix' en un solo mensaje.  No usa
+ * printf para que se pueda llamar desde tareas con poco stack.
+ */
+void messages_print_int( const char* prefix, long value, const char* suffix );
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -0,0 +1,50 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __PACK10_H__
+#define __PACK10_H__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Empaquetado de muestras de 10 bits, 4 muestras en 5 bytes.
+ * Cada grupo de muestras s0..s3 queda asi:
+ *   [0..3] los 8 bits altos de s0..s3 (s >> 2).
+ *   [4]    los 2 bits bajos: s0 en los bits 1:0, s1 en 3:2, s2 en 5:4 y s3 en
+ *          7:6.
+ * Los primeros 4 bytes de cada grupo son las mismas muestras que daria el ADC
+ * en 8 bits, asi que un receptor viejo puede ignorar el quinto byte.
+ */
+
+/// Muestras por grupo.
+#define PACK10_GROUP    4
+/// Bytes por grupo.
+#define PACK10_BYTES    5
+
+
+/**
+ * Empaqueta 'n' muestras de 'in' (n multiplo de PACK10_GROUP) en 'out', que
+ * debe tener lugar para n/4*5 bytes.  Solo se usan los 10 bits bajos.
+ */
+void pack10_encode( const uint16_t* in, unsigned n, uint8_t* out );
+
+/**
+ * Decodificador de referencia: desempaqueta 'n' muestras (n multiplo de
+ * PACK10_GROUP) de 'in' en 'out'.
+ */
+void pack10_decode( const uint8_t* in, unsigned n, uint16_t* out );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,95 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __RESAMPLE_H__
+#define __RESAMPLE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Remuestreo racional polifasico para muestras de 8 bits: la tasa de salida
+ * es la de entrada por up/down, con up <= down (solo se baja la tasa, asi se
+ * puede hacer sobre el mismo buffer).  Es el equivalente a intercalar up - 1
+ * ceros, filtrar con un pasabajos de corte en la nueva frecuencia de Nyquist
+ * y quedarse con una de cada down muestras, pero solo se calculan las salidas
+ * que quedan, con la fase del filtro que les toca.
+ *
+ * El pasabajos es un sinc con ventana de Hann en Q15, y cada fase se
+ * normaliza a ganancia 1 en continua.  Los coeficientes se calculan al cambiar
+ * la relacion.  Las muestras se centran en 128 y la salida se satura a
+ * 0..255, igual que en filter.h.
+ *
+ * La relacion se puede cambiar en cualquier momento con resample_set_ratio, y
+ * resample_apply (o resample_sync) la toma al principio del siguiente buffer.  El cambio no
+ * tiene saltos: la linea de retardo es la misma para cualquier relacion, asi
+ * que el filtro nuevo arranca con la historia completa; todos los filtros
+ * estan centrados en el mismo retardo, RESAMPLE_DELAY muestras de entrada,
+ * que es tambien el de 1/1; y la posicion de la proxima salida se conserva
+ * escalando la fase a la nueva relacion.
+ */
+
+/// Maximo factor de subida 'up'.
+#define RESAMPLE_UP_MAX     8
+/// Maximo factor de bajada 'down'.
+#define RESAMPLE_DOWN_MAX   255
+/// Coeficientes maximos por fase, y largo de la linea de retardo.
+#define RESAMPLE_TAPS_MAX   32
+/// Coeficientes por fase para cada muestra de salida en la entrada (down/up).
+#define RESAMPLE_TAPS_PER_OUT 4
+/// Retardo de la salida en muestras de entrada, igual para toda relacion.
+#define RESAMPLE_DELAY      (RESAMPLE_TAPS_MAX / 2)
+
+
+typedef struct _resample_type
+{
+    volatile uint16_t request;  // up << 8 | down pedido por resample_set_ratio
+    uint8_t     up;
+    uint8_t     down;
+    uint8_t     taps;           // Coeficientes por fase
+    uint16_t    phase;          // Posicion de la proxima salida, en 1/up de muestra
+    int16_t     coef[RESAMPLE_UP_MAX * RESAMPLE_TAPS_MAX]; // taps por fase, seguidos
+
+    // Linea de retardo duplicada, para leerla sin modulo
+    int16_t     hist[2 * RESAMPLE_TAPS_MAX];
+    unsigned    idx;
+}
+resample_type;
+
+
+/**
+ * Arranca con relacion 1/1 (sin remuestreo) y la linea de retardo en cero.
+ */
+void     resample_init     ( resample_type* r );
+
+/**
+ * Pide la relacion up/down, que se simplifica.  Se puede llamar desde otra
+ * tarea, se toma en el proximo resample_apply.  Devuelve -1 si la relacion no
+ * esta soportada, en tal caso sigue la anterior.
+ */
+int      resample_set_ratio( resample_type* r, unsigned up, unsigned down );
+
+/**
+ * Pasa a la relacion pedida, si cambio.  Lo hace resample_apply, sirve para
+ * saber antes la relacion del proximo buffer.
+ */
+void     resample_sync     ( resample_type* r );
+
+/**
+ * Remuestrea las 'n' muestras de 'buf' en el lugar.  Devuelve cuantas
+ * quedaron, al principio de 'buf'.
+ */
+unsigned resample_apply    ( resample_type* r, uint8_t* buf, unsigned n );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,54 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __SCALE_H__
+#define __SCALE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Escalado de muestras de 8 bits por una ganancia en punto fijo, saturando a
+ * 0..255.  La ganancia es q15 * 2^shift / 2^15, o sea un Q15 con un
+ * exponente entre 0 y SCALE_MAX_SHIFT, y cubre de -128 a casi 128.
+ * En el M4 se procesan 4 muestras por palabra con las instrucciones DSP
+ * (__SMUAD/__SMUADX y __USAT16 de a dos muestras), en otra arquitectura hay
+ * una version en C que da el mismo resultado.  Igual que la conversion de
+ * float a entero, el resultado se trunca.
+ */
+
+/// Exponente maximo de la ganancia, con el producto siempre en 16 bits.
+#define SCALE_MAX_SHIFT     7
+
+
+typedef struct _scale_gain
+{
+    int16_t     q15;
+    uint8_t     shift;
+}
+scale_gain;
+
+
+/**
+ * Convierte una ganancia en float al formato de scale_apply, con el menor
+ * exponente posible.  Las ganancias fuera de rango se saturan.
+ */
+scale_gain scale_gain_from_float( float gain );
+
+/**
+ * out[i] = saturar(in[i] * gain) para 'n' muestras.  'out' puede ser 'in'.
+ */
+void       scale_apply          ( const uint8_t* in, uint8_t* out, unsigned n, scale_gain gain );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,79 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __SPECTRUM_H__
+#define __SPECTRUM_H__
+
+/// 1: se compila con CMSIS-DSP, se define en config.mk.
+#ifndef SPECTRUM_USED
+#define SPECTRUM_USED       0
+#endif
+
+#if SPECTRUM_USED
+#include <arm_math.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Espectro de magnitud con la FFT real de CMSIS-DSP (en la FPU del M4F).
+ * Se juntan bloques de 'size' muestras de 8 bits, a cada uno se le aplica
+ * una ventana de Hann y la FFT, y se promedian las magnitudes de 'averages'
+ * bloques.  El resultado son size/2 bins (de 0 a fs/2, sin incluir fs/2) en
+ * punto fijo 8.8: la amplitud en cuentas del ADC de un seno en ese bin.  El
+ * bin 0 da el doble del valor medio.
+ * Necesita CMSIS-DSP (ARM_MATH_CM4 y la biblioteca, ver config.mk), por eso
+ * solo existe con SPECTRUM_USED en 1.
+ */
+
+/// Tamano maximo del bloque de la FFT.
+#define SPECTRUM_MAX_SIZE   256
+
+
+typedef struct _spectrum_type
+{
+    arm_rfft_fast_instance_f32 rfft;
+    unsigned    size;
+    unsigned    averages;
+    unsigned    n;       // Muestras en el bloque actual
+    unsigned    n_avg;   // Bloques sumados en 'acc'
+    float32_t   window[SPECTRUM_MAX_SIZE];
+    float32_t   in[SPECTRUM_MAX_SIZE];
+    float32_t   out[SPECTRUM_MAX_SIZE];
+    float32_t   acc[SPECTRUM_MAX_SIZE / 2];
+}
+spectrum_type;
+
+
+/**
+ * Inicializa para bloques de 'size' muestras, potencia de 2 entre 32 y
+ * SPECTRUM_MAX_SIZE, promediando 'averages' bloques.  Devuelve -1 si el tamano
+ * no es valido.
+ */
+int      spectrum_init( spectrum_type* sp, unsigned size, unsigned averages );
+
+/**
+ * Agrega una muestra.  Devuelve true cuando hay un espectro promediado listo
+ * para leer con spectrum_bins.
+ */
+bool     spectrum_push( spectrum_type* sp, uint8_t sample );
+
+/**
+ * Escribe los size/2 bins del ultimo espectro en 'out', reinicia el promedio
+ * y devuelve la cantidad de bins.
+ */
+unsigned spectrum_bins( spectrum_type* sp, uint16_t* out );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
+#endif
@@ -0,0 +1,79 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __SUMMARY_H__
+#define __SUMMARY_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Resumen estadistico de bloques de muestras de 8 bits: minimo, maximo, media
+ * y valor eficaz.  Los bloques son de 'size' muestras aunque lleguen en
+ * pedazos de cualquier largo.
+ * La acumulacion es una sola pasada que en el M4 usa las instrucciones SIMD
+ * (4 muestras por palabra: __USADA8 para la suma, __SMLAD para los cuadrados
+ * y __USUB8/__SEL para minimo y maximo).  En otra arquitectura se usa el
+ * mismo algoritmo muestra a muestra.
+ */
+
+/// Bytes de cada registro codificado con summary_encode.
+#define SUMMARY_RECORD_SIZE     8
+
+
+typedef struct _summary_record
+{
+    uint8_t     min;
+    uint8_t     max;
+    uint16_t    mean;   // Punto fijo 8.8
+    uint16_t    rms;    // Punto fijo 8.8
+    uint16_t    count;
+}
+summary_record;
+
+typedef struct _summary_type
+{
+    unsigned    size;
+    unsigned    n;
+    uint8_t     min;
+    uint8_t     max;
+    uint32_t    sum;
+    uint64_t    sum_sq;
+}
+summary_type;
+
+
+/**
+ * Inicializa para bloques de 'size' muestras (1 a 65535).  Devuelve -1 si el
+ * tamano no es valido.
+ */
+int      summary_init  ( summary_type* sm, unsigned size );
+
+/**
+ * Acumula muestras de 'samples' hasta completar el bloque o hasta 'n'.
+ * Devuelve cuantas uso; si completo el bloque deja el resultado en 'out',
+ * reinicia y pone 'done' en true.  Hay que volver a llamar con el resto.
+ */
+unsigned summary_push  ( summary_type* sm, const uint8_t* samples, unsigned n,
+                         summary_record* out, bool* done );
+
+/**
+ * Codifica el registro en SUMMARY_RECORD_SIZE bytes, little endian:
+ *   [0] minimo, [1] maximo, [2..3] media 8.8, [4..5] valor eficaz 8.8,
+ *   [6..7] cantidad de muestras.
+ */
+void     summary_encode( const summary_record* rec, uint8_t* out );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
@@ -0,0 +1,65 @@
+/*=============================================================================
+ * Copyright (c) 2019, Sebastian Ceola <sebastian.ceola@gmail.com>
+ * All rights reserved.
+ * License: mit (see LICENSE.txt)
+ * Version: 0.0.1
+ *===========================================================================*/
+
+#ifndef __TSTAMP_H__
+#define __TSTAMP_H__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Marcas de tiempo en microsegundos a partir de un contador de hardware libre
+ * (TIMER1), independiente del tick de FreeRTOS.  El contador da la vuelta
+ * cada ~71 minutos, asi que siempre trabajar con diferencias sin signo.
+ */
+
+
+/**
+ * Estadistica de jitter de un evento periodico.  Se guarda el desvio de cada
+ * intervalo medido respecto del nominal.
+ */
+typedef struct _tstamp_jitter
+{
+    uint32_t    nominal;  // Intervalo esperado en us
+    uint32_t    last;     // Ultima marca de tiempo
+    int32_t     min;      // Desvio minimo en us
+    int32_t     max;      // Desvio maximo en us
+    uint32_t    count;    // Cantidad de intervalos medidos
+    bool        started;
+}
+tstamp_jitter;
+
+
+/**
+ * Arranca el TIMER1 como contador libre de 1MHz.
+ */
+void     tstamp_init( void );
+
+/**
+ * Tiempo actual en microsegundos.  Se puede llamar desde interrupciones.
+ */
+uint32_t tstamp_now( void );
+
+/**
+ * Reinicia la estadistica para un intervalo nominal de 'nominal_us'.
+ */
+void     tstamp_jitter_reset( tstamp_jitter* j, uint32_t nominal_us );
+
+/**
+ * Agrega la marca 't' (de tstamp_now) del evento.
+ */
+void     tstamp_jitter_add( tstamp_jitter* j, uint32_t t );
+
+
+#ifdef __cplusplus
+}
+#endif
+#endif
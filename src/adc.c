@@ -1,5 +1,57 @@
+#include <FreeRTOS.h>
 #include "sapi.h"
 #include "adc.h"
+#include "tstamp.h"
+
+
+/// Linea de peticion del ADC0 en el GPDMA (no pasa por el DMAMUX).
+#define ADC_DMA_REQ_LINE    13
+/// Linea de peticion del ADC1 en el GPDMA.
+#define ADC1_DMA_REQ_LINE   14
+/// Seleccion de T0_MAT0 como entrada ADCSTART0 del GIMA.
+#define ADC_GIMA_T0_MAT0    (1 << 4)
+/// Seleccion de CTOUT_15/T3_MAT3 (ADCSTART0) y CTOUT_14/T3_MAT2 (ADCSTART1).
+#define ADC_GIMA_T3_MATx    (0 << 4)
+
+
+/// Unidades de DMA: una por ADC en uso.
+#define ADC_DMA_UNITS_MAX   2
+/// Campo CHN de GDR: canal de la ultima conversion.
+#define ADC_GDR_CHN(x)      (((x) >> 24) & 0x07)
+
+
+static unsigned s__dma_units;
+static uint8_t  s__dma_chn[ADC_DMA_UNITS_MAX];
+static uint32_t s__dma_req[ADC_DMA_UNITS_MAX];
+static uint32_t s__dma_src[ADC_DMA_UNITS_MAX];
+static uint8_t  s__dma_mask;     // Canales del ADC0
+static uint8_t  s__dma_claimed;  // Canales de DMA reservados por este modulo
+static uint32_t s__dma_pending;  // Canales de DMA que faltan terminar
+static uint32_t s__conv_us;      // Duracion de una conversion en burst
+
+// En un barrido la ultima muestra de cada buffer se lee como palabra entera
+// de GDR por un segundo descriptor, para ver de que canal es.
+static DMA_TransferDescriptor_t s__dma_tail;
+static volatile uint32_t s__dma_tail_word;
+static uint8_t* s__dma_tail_dst;   // Donde va la muestra de la ultima palabra
+static uint8_t  s__dma_tail_chn;   // Canal que le corresponde
+static bool     s__dma_aligned;
+
+static int             s__irq_chn;
+static adc_irq_handler s__irq_handler = NULL;
+
+
+/**
+ * Cantidad de canales en 'mask'.
+ */
+static unsigned s__popcount( uint8_t mask )
+{
+    unsigned n = 0;
+    for (; mask != 0; mask >>= 1)
+        n += mask & 1;
+    return n;
+}
+
 
 void adc_init( void )
 {
@@ -28,3 +80,409 @@ uint8_t adc_read( int chn )
 {
     return adcRead(chn);
 }
+
+void adc_set_resolution( unsigned bits )
+{
+    ADC_CLOCK_SETUP_T ADCSetup = {
+       ADC_MAX_SAMPLE_RATE,
+       ADC_8BITS,
+       DISABLE
+    };
+
+    // ADC_10BITS..ADC_8BITS estan en orden descendente de resolucion.
+    Chip_ADC_SetResolution( LPC_ADC0, &ADCSetup, ADC_10BITS + (10 - bits) );
+}
+
+uint16_t adc_read10( int chn )
+{
+    return adcRead(chn);
+}
+
+void adc_irq_start( int chn, adc_irq_handler handler )
+{
+    s__irq_chn     = chn;
+    s__irq_handler = handler;
+
+    Chip_ADC_Int_SetChannelCmd( LPC_ADC0, chn, ENABLE );
+
+    // Desde el handler se usan funciones FromISR de FreeRTOS.
+    NVIC_SetPriority(ADC0_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY);
+    NVIC_ClearPendingIRQ(ADC0_IRQn);
+    NVIC_EnableIRQ(ADC0_IRQn);
+}
+
+void adc_irq_stop( int chn )
+{
+    NVIC_DisableIRQ(ADC0_IRQn);
+    Chip_ADC_Int_SetChannelCmd( LPC_ADC0, chn, DISABLE );
+    s__irq_handler = NULL;
+}
+
+void ADC0_IRQHandler( void )
+{
+    // Leer el registro de datos limpia el DONE y la interrupcion.
+    uint32_t dr = LPC_ADC0->DR[s__irq_chn];
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    if (s__irq_handler != NULL && s__irq_handler(ADC_DR_RESULT(dr)))
+        xHigherPriorityTaskWoken = pdTRUE;
+
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+void adc_burst_start( int chn, uint32_t rate )
+{
+    ADC_CLOCK_SETUP_T ADCSetup = {
+       ADC_MAX_SAMPLE_RATE,
+       ADC_8BITS,
+       ENABLE
+    };
+
+    Chip_ADC_SetSampleRate( LPC_ADC0, &ADCSetup, rate );
+    Chip_ADC_EnableChannel( LPC_ADC0, chn, ENABLE );
+    Chip_ADC_SetBurstCmd( LPC_ADC0, ENABLE );
+    s__conv_us = 1000000UL / rate + 1;
+}
+
+void adc_burst_stop( int chn )
+{
+    Chip_ADC_SetBurstCmd( LPC_ADC0, DISABLE );
+    Chip_ADC_EnableChannel( LPC_ADC0, chn, DISABLE );
+}
+
+void adc_scan_start( uint8_t mask, uint32_t rate )
+{
+    ADC_CLOCK_SETUP_T ADCSetup = {
+       ADC_MAX_SAMPLE_RATE,
+       ADC_8BITS,
+       ENABLE
+    };
+
+    Chip_ADC_SetSampleRate( LPC_ADC0, &ADCSetup, rate );
+    for (int chn = ADC_CH0; chn <= ADC_CH7; ++chn)
+    {
+        if (mask & (1 << chn))
+            Chip_ADC_EnableChannel( LPC_ADC0, chn, ENABLE );
+    }
+    Chip_ADC_SetBurstCmd( LPC_ADC0, ENABLE );
+    s__conv_us = 1000000UL / rate + 1;
+}
+
+void adc_scan_stop( uint8_t mask )
+{
+    Chip_ADC_SetBurstCmd( LPC_ADC0, DISABLE );
+    for (int chn = ADC_CH0; chn <= ADC_CH7; ++chn)
+    {
+        if (mask & (1 << chn))
+            Chip_ADC_EnableChannel( LPC_ADC0, chn, DISABLE );
+    }
+}
+
+void adc_timer_start( int chn, uint32_t period_us )
+{
+    // MAT0 cambia de estado en cada match y el ADC convierte en el flanco
+    // ascendente, asi que hay un disparo cada dos matches.  El timer corre sin
+    // prescaler para tener la mejor resolucion posible.
+    uint32_t half = ((uint64_t) Chip_Clock_GetRate(CLK_MX_TIMER0) * period_us) / 2000000;
+    if (half == 0)
+        half = 1;
+
+    Chip_TIMER_Init(LPC_TIMER0);
+    Chip_TIMER_Reset(LPC_TIMER0);
+    Chip_TIMER_PrescaleSet(LPC_TIMER0, 0);
+    Chip_TIMER_SetMatch(LPC_TIMER0, 0, half - 1);
+    Chip_TIMER_ResetOnMatchEnable(LPC_TIMER0, 0);
+    Chip_TIMER_ExtMatchControlSet(LPC_TIMER0, 0, TIMER_EXTMATCH_TOGGLE, 0);
+
+    // ADCSTART0 llega al ADC0 como la entrada de disparo de CTOUT_15.
+    LPC_GIMA->ADCSTART0_IN = ADC_GIMA_T0_MAT0;
+
+    Chip_ADC_SetBurstCmd( LPC_ADC0, DISABLE );
+    Chip_ADC_EnableChannel( LPC_ADC0, chn, ENABLE );
+    Chip_ADC_SetStartMode( LPC_ADC0, ADC_START_ON_CTOUT15, ADC_TRIGGERMODE_RISING );
+
+    Chip_TIMER_Enable(LPC_TIMER0);
+}
+
+void adc_timer_stop( int chn )
+{
+    Chip_TIMER_Disable(LPC_TIMER0);
+    Chip_ADC_SetStartMode( LPC_ADC0, ADC_NO_START, ADC_TRIGGERMODE_RISING );
+    Chip_ADC_EnableChannel( LPC_ADC0, chn, DISABLE );
+}
+
+void adc_dual_start( int chn0, int chn1, uint32_t period_us, bool offset )
+{
+    ADC_CLOCK_SETUP_T ADCSetup = {
+       ADC_MAX_SAMPLE_RATE,
+       ADC_8BITS,
+       DISABLE
+    };
+
+    // El ADC1 arranca igual que el ADC0 en adc_init.
+    Chip_ADC_Init( LPC_ADC1, &ADCSetup );
+    Chip_ADC_SetSampleRate( LPC_ADC1, &ADCSetup, ADC_MAX_SAMPLE_RATE/2 );
+    Chip_ADC_SetBurstCmd( LPC_ADC1, DISABLE );
+
+    // Los dos ADCs se disparan con el mismo TIMER3: MAT3 va al ADC0 y MAT2 al
+    // ADC1.  Ambos matches son en la misma cuenta y cambian de estado cada
+    // medio periodo, el ADC convierte en el flanco ascendente.  Si arrancan
+    // en estados opuestos los flancos se alternan y el ADC1 muestrea medio
+    // periodo despues que el ADC0.
+    uint32_t half = ((uint64_t) Chip_Clock_GetRate(CLK_MX_TIMER3) * period_us) / 2000000;
+    if (half == 0)
+        half = 1;
+
+    Chip_TIMER_Init(LPC_TIMER3);
+    Chip_TIMER_Reset(LPC_TIMER3);
+    Chip_TIMER_PrescaleSet(LPC_TIMER3, 0);
+    Chip_TIMER_SetMatch(LPC_TIMER3, 0, half - 1);
+    Chip_TIMER_SetMatch(LPC_TIMER3, 2, half - 1);
+    Chip_TIMER_SetMatch(LPC_TIMER3, 3, half - 1);
+    Chip_TIMER_ResetOnMatchEnable(LPC_TIMER3, 0);
+    Chip_TIMER_ExtMatchControlSet(LPC_TIMER3, 0, TIMER_EXTMATCH_TOGGLE, 3);
+    Chip_TIMER_ExtMatchControlSet(LPC_TIMER3, offset ? 1 : 0, TIMER_EXTMATCH_TOGGLE, 2);
+
+    LPC_GIMA->ADCSTART0_IN = ADC_GIMA_T3_MATx;
+    LPC_GIMA->ADCSTART1_IN = ADC_GIMA_T3_MATx;
+
+    Chip_ADC_SetBurstCmd( LPC_ADC0, DISABLE );
+    Chip_ADC_EnableChannel( LPC_ADC0, chn0, ENABLE );
+    Chip_ADC_EnableChannel( LPC_ADC1, chn1, ENABLE );
+    Chip_ADC_SetStartMode( LPC_ADC0, ADC_START_ON_CTOUT15, ADC_TRIGGERMODE_RISING );
+    Chip_ADC_SetStartMode( LPC_ADC1, ADC_START_ON_CTOUT15, ADC_TRIGGERMODE_RISING );
+
+    Chip_TIMER_Enable(LPC_TIMER3);
+}
+
+void adc_dual_stop( int chn0, int chn1 )
+{
+    Chip_TIMER_Disable(LPC_TIMER3);
+    Chip_ADC_SetStartMode( LPC_ADC0, ADC_NO_START, ADC_TRIGGERMODE_RISING );
+    Chip_ADC_SetStartMode( LPC_ADC1, ADC_NO_START, ADC_TRIGGERMODE_RISING );
+    Chip_ADC_EnableChannel( LPC_ADC0, chn0, DISABLE );
+    Chip_ADC_EnableChannel( LPC_ADC1, chn1, DISABLE );
+}
+
+/**
+ * Reserva el canal de DMA de la unidad 'u' para leer desde 'src' con la linea
+ * de peticion 'req'.  Devuelve -1 si no hay canales libres.
+ */
+static int s__dma_unit_setup( unsigned u, uint32_t conn, uint32_t req, uint32_t src )
+{
+    // Chip_GPDMA_GetFreeChannel devuelve 0 tanto para el canal 0 como cuando
+    // no queda ninguno libre.  Despues de Chip_GPDMA_Init estan todos libres,
+    // asi que un 0 que ya tenemos reservado o que esta andando es que fallo.
+    const uint8_t chn = Chip_GPDMA_GetFreeChannel(LPC_GPDMA, conn);
+    if ((s__dma_claimed & (1U << chn)) != 0 ||
+        Chip_GPDMA_IntGetStatus(LPC_GPDMA, GPDMA_STAT_ENABLED_CH, chn) == SET)
+        return -1;
+
+    s__dma_claimed |= 1U << chn;
+    s__dma_chn[u] = chn;
+    s__dma_req[u] = req;
+    s__dma_src[u] = src;
+    return 0;
+}
+
+/**
+ * Habilita el pedido de DMA de los canales de 'mask' en 'adc' y devuelve la
+ * direccion desde donde leerlos.
+ */
+static uint32_t s__dma_adc_setup( LPC_ADC_T* adc, uint8_t mask )
+{
+    uint32_t src = (uint32_t) &adc->GDR;
+
+    // El ADC pide DMA cuando esta habilitada la interrupcion del canal, pero
+    // la interrupcion en si queda apagada en el NVIC.
+    for (int chn = ADC_CH0; chn <= ADC_CH7; ++chn)
+    {
+        if (mask & (1 << chn))
+        {
+            Chip_ADC_Int_SetChannelCmd( adc, chn, ENABLE );
+            if (s__popcount(mask) == 1)
+                src = (uint32_t) &adc->DR[chn];
+        }
+    }
+    return src;
+}
+
+static void s__dma_init( void )
+{
+    Chip_GPDMA_Init(LPC_GPDMA);
+    s__dma_units   = 0;
+    s__dma_claimed = 0;
+}
+
+static void s__dma_irq_setup( void )
+{
+    // Desde DMA_IRQHandler se usan funciones FromISR de FreeRTOS.
+    NVIC_SetPriority(DMA_IRQn, configLIBRARY_MAX_SYSCALL_INTERRUPT_PRIORITY);
+    NVIC_ClearPendingIRQ(DMA_IRQn);
+    NVIC_EnableIRQ(DMA_IRQn);
+}
+
+int adc_hw_dma_setup( uint8_t mask )
+{
+    s__dma_init();
+    s__dma_mask = mask;
+    if (s__dma_unit_setup(0, GPDMA_CONN_ADC_0, ADC_DMA_REQ_LINE, s__dma_adc_setup(LPC_ADC0, mask)) < 0)
+        return -1;
+    s__dma_units = 1;
+    NVIC_DisableIRQ(ADC0_IRQn);
+
+    s__dma_irq_setup();
+    return 0;
+}
+
+int adc_hw_dma_setup_dual( int chn0, int chn1 )
+{
+    s__dma_init();
+    s__dma_mask = 1 << chn0;
+    if (s__dma_unit_setup(0, GPDMA_CONN_ADC_0, ADC_DMA_REQ_LINE, s__dma_adc_setup(LPC_ADC0, 1 << chn0)) < 0 ||
+        s__dma_unit_setup(1, GPDMA_CONN_ADC_1, ADC1_DMA_REQ_LINE, s__dma_adc_setup(LPC_ADC1, 1 << chn1)) < 0)
+        return -1;
+    s__dma_units = 2;
+    NVIC_DisableIRQ(ADC0_IRQn);
+    NVIC_DisableIRQ(ADC1_IRQn);
+
+    s__dma_irq_setup();
+    return 0;
+}
+
+/**
+ * Canal de la muestra 'i' de un barrido de los canales de 'mask', que van
+ * del mas bajo al mas alto.
+ */
+static uint8_t s__scan_chn( uint8_t mask, unsigned i )
+{
+    i %= s__popcount(mask);
+    for (uint8_t chn = ADC_CH0; chn <= ADC_CH7; ++chn)
+    {
+        if ((mask & (1 << chn)) && i-- == 0)
+            return chn;
+    }
+    return 0;
+}
+
+void adc_hw_dma_transfer( uint8_t* dst, unsigned n )
+{
+    // Con dos ADCs cada uno llena su mitad.
+    n /= s__dma_units;
+    s__dma_pending = 0;
+
+    // Si se pierde un pedido de DMA en un barrido, todas las muestras que
+    // siguen quedan corridas un canal.  El dato de 8 bits no dice de que
+    // canal es, asi que la ultima se lee entera y adc_hw_dma_ack la revisa.
+    const bool scan = s__dma_units == 1 && s__popcount(s__dma_mask) > 1 && n > 1;
+    s__dma_aligned = true;
+    s__dma_tail_dst = NULL;
+    if (scan)
+    {
+        s__dma_tail_dst = dst + n - 1;
+        s__dma_tail_chn = s__scan_chn(s__dma_mask, n - 1);
+        s__dma_tail.src  = s__dma_src[0];
+        s__dma_tail.dst  = (uint32_t) &s__dma_tail_word;
+        s__dma_tail.lli  = 0;
+        s__dma_tail.ctrl = GPDMA_DMACCxControl_TransferSize(1)
+                         | GPDMA_DMACCxControl_SBSize(GPDMA_BSIZE_1)
+                         | GPDMA_DMACCxControl_DBSize(GPDMA_BSIZE_1)
+                         | GPDMA_DMACCxControl_SWidth(GPDMA_WIDTH_WORD)
+                         | GPDMA_DMACCxControl_DWidth(GPDMA_WIDTH_WORD)
+                         | GPDMA_DMACCxControl_I;
+        n--;
+    }
+
+    for (unsigned u = 0; u < s__dma_units; ++u)
+    {
+        GPDMA_CH_T* ch = &LPC_GPDMA->CH[s__dma_chn[u]];
+
+        LPC_GPDMA->INTTCCLEAR = 1UL << s__dma_chn[u];
+        LPC_GPDMA->INTERRCLR  = 1UL << s__dma_chn[u];
+        s__dma_pending |= 1UL << s__dma_chn[u];
+
+        // El resultado ocupa los bits 15:6 del registro, con ADC_8BITS la
+        // muestra es directamente el byte 1, asi que el DMA lee de a un byte
+        // desde ahi y no hay que acomodar nada despues.
+        ch->SRCADDR  = s__dma_src[u] + 1;
+        ch->DESTADDR = (uint32_t) (dst + u*n);
+        ch->LLI      = scan ? (uint32_t) &s__dma_tail : 0;
+        ch->CONTROL  = GPDMA_DMACCxControl_TransferSize(n)
+                     | GPDMA_DMACCxControl_SBSize(GPDMA_BSIZE_1)
+                     | GPDMA_DMACCxControl_DBSize(GPDMA_BSIZE_1)
+                     | GPDMA_DMACCxControl_SWidth(GPDMA_WIDTH_BYTE)
+                     | GPDMA_DMACCxControl_DWidth(GPDMA_WIDTH_BYTE)
+                     | GPDMA_DMACCxControl_DI
+                     | (scan ? 0 : GPDMA_DMACCxControl_I);
+        ch->CONFIG   = GPDMA_DMACCxConfig_SrcPeripheral(s__dma_req[u])
+                     | GPDMA_DMACCxConfig_TransferType(GPDMA_TRANSFERTYPE_P2M_CONTROLLER_DMA)
+                     | GPDMA_DMACCxConfig_IE
+                     | GPDMA_DMACCxConfig_ITC
+                     | GPDMA_DMACCxConfig_E;
+    }
+}
+
+void adc_hw_dma_restart( uint8_t* dst, unsigned n )
+{
+    if (s__dma_units == 1 && s__popcount(s__dma_mask) > 1 && (LPC_ADC0->CR & ADC_CR_BURST))
+    {
+        // Cortamos el burst, dejamos terminar la conversion en curso y
+        // limpiamos los DONE leyendo los registros.  Al volver a habilitarlo
+        // el barrido arranca otra vez por el canal mas bajo y los datos
+        // quedan alineados con el encabezado.
+        Chip_ADC_SetBurstCmd( LPC_ADC0, DISABLE );
+        uint32_t t0 = tstamp_now();
+        while (tstamp_now() - t0 < s__conv_us)
+        {
+        }
+        (void) LPC_ADC0->GDR;
+        for (int chn = ADC_CH0; chn <= ADC_CH7; ++chn)
+        {
+            if (s__dma_mask & (1 << chn))
+                (void) LPC_ADC0->DR[chn];
+        }
+
+        adc_hw_dma_transfer(dst, n);
+        Chip_ADC_SetBurstCmd( LPC_ADC0, ENABLE );
+    }
+    else
+    {
+        adc_hw_dma_transfer(dst, n);
+    }
+}
+
+void adc_hw_dma_stop( void )
+{
+    for (unsigned u = 0; u < s__dma_units; ++u)
+        Chip_GPDMA_Stop(LPC_GPDMA, s__dma_chn[u]);
+    s__dma_pending = 0;
+}
+
+bool adc_hw_dma_ack( void )
+{
+    uint32_t mask = 0;
+    for (unsigned u = 0; u < s__dma_units; ++u)
+        mask |= 1UL << s__dma_chn[u];
+
+    uint32_t done = LPC_GPDMA->INTTCSTAT & mask;
+    LPC_GPDMA->INTTCCLEAR = mask;
+    LPC_GPDMA->INTERRCLR  = mask;
+
+    // Con dos ADCs el buffer esta completo recien cuando terminaron ambos.
+    bool ret = (done & s__dma_pending) != 0;
+    s__dma_pending &= ~done;
+    ret = ret && s__dma_pending == 0;
+
+    if (ret && s__dma_tail_dst != NULL)
+    {
+        const uint32_t word = s__dma_tail_word;
+        *s__dma_tail_dst = word >> 8;
+        s__dma_aligned   = ADC_GDR_CHN(word) == s__dma_tail_chn;
+    }
+    return ret;
+}
+
+bool adc_hw_dma_aligned( void )
+{
+    return s__dma_aligned;
+}
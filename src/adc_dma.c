@@ -0,0 +1,271 @@
+#include "adc_dma.h"
+#include "adc.h"
+
+
+/// Instancia que atiende DMA_IRQHandler.
+static adc_dma_type* s__adc_dma = NULL;
+
+
+/*
+ * Los buffers se piden y se entregan tanto desde la tarea (al arrancar o si el
+ * DMA se detuvo) como desde la interrupcion.  Con 'pxWoken' en NULL es desde
+ * la tarea.
+ */
+static uint8_t* s__get_avail( adc_dma_type* ad, BaseType_t* pxWoken )
+{
+    if (pxWoken == NULL)
+        return buffer_queue_get_avail(ad->bq, 0);
+    return buffer_queue_get_avail_from_isr(ad->bq, pxWoken);
+}
+
+static uint8_t* s__reserve( adc_dma_type* ad, BaseType_t* pxWoken )
+{
+    // Igual que en adc_update, si no hay buffers disponibles descartamos el
+    // mas viejo de los que estan en uso y lo reutilizamos.  Con varios
+    // consumidores recien esta disponible cuando lo soltaron todos.
+    uint8_t* buf = s__get_avail(ad, pxWoken);
+    if (buf == NULL)
+    {
+        const bool dropped = (pxWoken == NULL) ? buffer_queue_drop_oldest(ad->bq)
+                                               : buffer_queue_drop_oldest_from_isr(ad->bq, pxWoken);
+        if (dropped)
+        {
+            ad->dropped++;
+            buf = s__get_avail(ad, pxWoken);
+        }
+    }
+
+    // El encabezado se escribe ahora, el DMA solo escribe despues de el.
+    if (buf != NULL)
+    {
+        for (unsigned i = 0; i < ad->hdr_len; ++i)
+            buf[i] = ad->hdr[i];
+    }
+    return buf;
+}
+
+static void s__offer( adc_dma_type* ad )
+{
+    if (ad->next != NULL)
+        return;
+    uint8_t* buf = s__reserve(ad, NULL);
+    if (buf == NULL)
+        return;
+
+    taskENTER_CRITICAL();
+    if (ad->next == NULL)
+    {
+        ad->next = buf;
+        buf = NULL;
+    }
+    taskEXIT_CRITICAL();
+
+    // La interrupcion se adelanto y ya reservo uno.
+    if (buf != NULL)
+        buffer_queue_return(ad->bq, buf);
+}
+
+static void s__refill( adc_dma_type* ad )
+{
+    s__offer(ad);
+
+    // Si el DMA se detuvo por falta de buffer lo volvemos a arrancar.
+    taskENTER_CRITICAL();
+    if (!ad->running && ad->next != NULL)
+    {
+        ad->active  = ad->next;
+        ad->next    = NULL;
+        ad->running = true;
+        ad->jitter.started = false; // El hueco no cuenta como jitter
+        adc_hw_dma_restart(ad->active + ad->hdr_len, ad->len);
+    }
+    taskEXIT_CRITICAL();
+
+    s__offer(ad);
+}
+
+static void s__stamp( adc_dma_type* ad, uint8_t* buf, uint32_t now )
+{
+    // La interrupcion marca la ultima muestra, la primera fue n_periods-1
+    // periodos antes.
+    const uint32_t t = now - (ad->n_periods - 1) * ad->period_us;
+    buffer_queue_set_meta(ad->bq, buf, t);
+
+    const int idx = buffer_queue_index(ad->bq, buf);
+    if (idx >= 0)
+    {
+        adc_dma_buf_info* info = &ad->info[idx];
+        info->period_us = ad->period_us;
+        info->dropped   = ad->dropped;
+        info->seq       = ad->seq;
+    }
+    ad->seq++;
+
+    if (ad->ts_offset >= 0)
+    {
+        uint8_t* p = buf + ad->ts_offset;
+        p[0] = t;
+        p[1] = t >> 8;
+        p[2] = t >> 16;
+        p[3] = t >> 24;
+    }
+}
+
+
+void adc_dma_init( adc_dma_type* ad, buffer_queue* bq )
+{
+    ad->bq       = bq;
+    ad->hdr_len  = 0;
+    ad->len      = bq->size;
+    ad->ts_offset = -1;
+    ad->period_us = 0;
+    ad->n_periods = bq->size;
+    ad->task     = NULL;
+    ad->active   = NULL;
+    ad->next     = NULL;
+    ad->running  = false;
+    ad->overruns = 0;
+    ad->dropped  = 0;
+    ad->misaligned = 0;
+    ad->seq      = 0;
+    tstamp_jitter_reset(&ad->jitter, 0);
+
+    s__adc_dma = ad;
+}
+
+void adc_dma_set_frame( adc_dma_type* ad, const uint8_t* hdr, unsigned hdr_len, unsigned len )
+{
+    configASSERT(hdr_len <= ADC_DMA_HDR_MAX && hdr_len + len <= ad->bq->size);
+
+    for (unsigned i = 0; i < hdr_len; ++i)
+        ad->hdr[i] = hdr[i];
+    ad->hdr_len = hdr_len;
+    ad->len     = len;
+}
+
+void adc_dma_set_period( adc_dma_type* ad, uint32_t period_us, unsigned n )
+{
+    taskENTER_CRITICAL();
+    ad->period_us = period_us;
+    ad->n_periods = n;
+    tstamp_jitter_reset(&ad->jitter, period_us * n);
+    taskEXIT_CRITICAL();
+}
+
+void adc_dma_set_timestamp( adc_dma_type* ad, int offset )
+{
+    configASSERT(offset < 0 || (unsigned) offset + 4 <= ad->hdr_len);
+    ad->ts_offset = offset;
+}
+
+const adc_dma_buf_info* adc_dma_get_info( const adc_dma_type* ad, const uint8_t* buf )
+{
+    const int idx = buffer_queue_index(ad->bq, buf);
+    return (idx >= 0) ? &ad->info[idx] : NULL;
+}
+
+void adc_dma_take_jitter( adc_dma_type* ad, tstamp_jitter* out )
+{
+    taskENTER_CRITICAL();
+    *out = ad->jitter;
+    tstamp_jitter_reset(&ad->jitter, ad->jitter.nominal);
+    taskEXIT_CRITICAL();
+}
+
+void adc_dma_start( adc_dma_type* ad )
+{
+    ad->task = xTaskGetCurrentTaskHandle();
+    s__refill(ad);
+}
+
+void adc_dma_stop( adc_dma_type* ad )
+{
+    uint8_t* active;
+    uint8_t* next;
+
+    taskENTER_CRITICAL();
+    adc_hw_dma_stop();
+    active      = ad->running ? ad->active : NULL;
+    next        = ad->next;
+    ad->active  = NULL;
+    ad->next    = NULL;
+    ad->running = false;
+    taskEXIT_CRITICAL();
+
+    // El que estaba a medio llenar se descarta.
+    if (active != NULL)
+        buffer_queue_return(ad->bq, active);
+    if (next != NULL)
+        buffer_queue_return(ad->bq, next);
+}
+
+void adc_dma_update( adc_dma_type* ad, TickType_t xTicksToWait )
+{
+    ulTaskNotifyTake(pdTRUE, xTicksToWait);
+
+    s__refill(ad);
+}
+
+void adc_dma_irq( adc_dma_type* ad, BaseType_t* pxHigherPriorityTaskWoken )
+{
+    if (!ad->running)
+        return;
+
+    uint32_t now = tstamp_now();
+
+    uint8_t* done = ad->active;
+    if (!adc_hw_dma_aligned())
+    {
+        // Se perdio un pedido de DMA en el barrido y las muestras quedaron
+        // corridas de canal.  El buffer se descarta y, como despues de un
+        // overrun, la tarea rearranca el DMA alineado.
+        ad->active  = NULL;
+        ad->running = false;
+        ad->misaligned++;
+        ad->seq++;  // Se ve como un salto en la secuencia
+        if (ad->next == NULL)
+            ad->next = done;  // El encabezado sigue escrito
+        else
+            buffer_queue_return_from_isr(ad->bq, done, pxHigherPriorityTaskWoken);
+        if (ad->task != NULL)
+            vTaskNotifyGiveFromISR(ad->task, pxHigherPriorityTaskWoken);
+        return;
+    }
+
+    // Primero rearrancamos el DMA, lo demas puede esperar.
+    if (ad->next != NULL)
+    {
+        ad->active = ad->next;
+        ad->next   = NULL;
+        adc_hw_dma_transfer(ad->active + ad->hdr_len, ad->len);
+    }
+    else
+    {
+        ad->active  = NULL;
+        ad->running = false;
+        ad->overruns++;
+    }
+
+    tstamp_jitter_add(&ad->jitter, now);
+
+    // El lleno va directo a la lista en uso y el proximo se reserva aca
+    // mismo, la tarea solo interviene si el DMA se detuvo.
+    s__stamp(ad, done, now);
+    buffer_queue_push_from_isr(ad->bq, done, pxHigherPriorityTaskWoken);
+    if (ad->next == NULL)
+        ad->next = s__reserve(ad, pxHigherPriorityTaskWoken);
+
+    if (!ad->running && ad->task != NULL)
+        vTaskNotifyGiveFromISR(ad->task, pxHigherPriorityTaskWoken);
+}
+
+
+void DMA_IRQHandler( void )
+{
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    if (adc_hw_dma_ack() && s__adc_dma != NULL)
+        adc_dma_irq(s__adc_dma, &xHigherPriorityTaskWoken);
+
+    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
@@ -0,0 +1,50 @@
+#include "adc_stream.h"
+#include "adc.h"
+
+
+/// Instancia que atiende la interrupcion del ADC.
+static adc_stream_type* s__adc_stream = NULL;
+
+
+static bool s__on_sample( uint16_t sample )
+{
+    adc_stream_type* as = s__adc_stream;
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    // El ADC esta en 8 bits, los 2 bits bajos del resultado no valen.
+    uint8_t data = sample >> 2;
+    if (xStreamBufferSendFromISR(as->sb, &data, 1, &xHigherPriorityTaskWoken) != 1)
+        as->dropped++;
+
+    return xHigherPriorityTaskWoken == pdTRUE;
+}
+
+
+int adc_stream_init( adc_stream_type* as, uint8_t* mem, size_t size, size_t trigger )
+{
+    as->dropped = 0;
+    as->sb = xStreamBufferCreateStatic(size, trigger, mem, &as->sb_static);
+    return (as->sb != NULL) ? 0 : -1;
+}
+
+void adc_stream_start( adc_stream_type* as, int chn, uint32_t period_us )
+{
+    s__adc_stream = as;
+
+    adc_irq_start(chn, s__on_sample);
+    adc_timer_start(chn, period_us);
+}
+
+size_t adc_stream_read( adc_stream_type* as, uint8_t* buf, size_t n, TickType_t xTicksToWait )
+{
+    // Con n igual al nivel de disparo vuelve recien cuando estan todas.
+    size_t got = 0;
+    while (got < n)
+    {
+        size_t r = xStreamBufferReceive(as->sb, buf + got, n - got, xTicksToWait);
+        if (r == 0)
+            break;
+        got += r;
+    }
+    return got;
+}
@@ -9,6 +9,7 @@
 #include "mpu.h"
 #include "bluetooth.h"
 #include "messages.h"
+#include "bench.h"
 
 
 // DEBUG
@@ -20,6 +21,21 @@
 /// Memoria estatica de la aplicacion, para no ponerla en el stack.
 uint8_t buffer_queue_mem[APP_DATA_BUF_SIZE * APP_DATA_BUF_NMBR];
 
+/**
+ * Como xTaskCreate pero con el stack y el TCB estaticos, uno por cada lugar
+ * donde se usa, asi las tareas no piden memoria al heap.
+ */
+#define APP_TASK_CREATE( fn, name, depth, param, prio, handle )                 \
+    do {                                                                        \
+        static StackType_t  s__stack[depth];                                    \
+        static StaticTask_t s__tcb;                                             \
+        TaskHandle_t* const s__handle = (handle);                               \
+        TaskHandle_t s__task = xTaskCreateStatic(fn, name, depth, param, prio,  \
+                                                 s__stack, &s__tcb);            \
+        if (s__handle != NULL)                                                  \
+            *s__handle = s__task;                                               \
+    } while (0)
+
 
 /**
  * Tarea principal, espera que haya muestras del ADC y las envia por la UART
@@ -36,6 +52,22 @@ void vTaskApp( void *pParam );
  */
 void vTaskADC( void *pParam );
 
+/**
+ * Tarea del ADC con el front-end de sobremuestreo (APP_ADC_CIC_ORDER > 0).  En
+ * lugar de un vTaskDelayUntil espera cada salida del decimador, que ya viene a
+ * la tasa configurada, y la pasa por adc_update.
+ */
+void vTaskADCCIC( void *pParam );
+
+/**
+ * Tarea del ADC para los modos que usan GPDMA (APP_ADC_USES_DMA).  Las
+ * muestras las copia el GPDMA y los buffers los entrega y reserva la
+ * interrupcion, la tarea solo se despierta para rearrancar el DMA si se
+ * detuvo por falta de buffers.  En modo timer tambien reprograma el periodo
+ * cuando cambia la configuracion.
+ */
+void vTaskADCDMA( void *pParam );
+
 /**
  * Trea de recepcion Bluetooth.  Esta escuchando la UART Bluetooth en caso de
  * recibir algun mensaje, para simplificar las cosas aceptamos cualquier mensaje
@@ -66,6 +98,538 @@ void vTaskError( void *pParam );
  */
 void vTaskMPU( void *pParam );
 
+/**
+ * Segundo consumidor de los buffers del ADC (APP_SINK_UART).  Vuelca cada
+ * buffer en hexadecimal por la UART de mensajes y lo devuelve, sin
+ * modificarlo porque vTaskApp tiene el mismo.
+ */
+void vTaskSinkUart( void *pParam );
+
+
+/**
+ * Imprime la estadistica de jitter del muestreo por la UART de mensajes.
+ */
+void s__report_jitter( const tstamp_jitter* j )
+{
+    messages_print_int("ADC jitter, nominal [us]: ", j->nominal, "\n\r");
+    messages_print_int("  min [us]: ", j->min, "\n\r");
+    messages_print_int("  max [us]: ", j->max, "\n\r");
+    messages_print_int("  n: ", j->count, "\n\r");
+}
+
+/**
+ * Imprime la politica y los contadores de overrun por la UART de mensajes.
+ */
+void s__report_overrun( app_type* app )
+{
+    app_overrun ov;
+    app_get_overrun(app, &ov);
+    messages_print_int("ADC overrun, politica: ", ov.policy, "\n\r");
+    messages_print_int("  buffers viejos descartados: ", ov.dropped_oldest, "\n\r");
+    messages_print_int("  muestras nuevas descartadas: ", ov.dropped_newest, "\n\r");
+    messages_print_int("  esperas: ", ov.blocked, "\n\r");
+    messages_print_int("  esperas vencidas: ", ov.block_timeouts, "\n\r");
+    messages_print_int("  muestras decimadas: ", ov.decimated, "\n\r");
+    messages_print_int("  decimacion: ", 1L << ov.decim_shift, "\n\r");
+}
+
+/**
+ * Imprime las estadisticas de cada consumidor del buffer_queue.
+ */
+void s__report_consumers( const app_type* app )
+{
+    const buffer_queue* bq = &app->data_queue;
+    for (unsigned c = 0; c < bq->n_consumers; ++c)
+    {
+        buffer_queue_stats st;
+        buffer_queue_get_stats(bq, c, &st);
+        messages_print_int("Consumidor ", c, "\n\r");
+        messages_print_int("  buffers: ", st.taken, "\n\r");
+        messages_print_int("  atraso max: ", st.lag_max, "\n\r");
+        messages_print_int("  edad max [ms]: ", st.age_max * portTICK_PERIOD_MS, "\n\r");
+        if (st.taken > 0)
+            messages_print_int("  edad media [ms]: ", st.age_sum * portTICK_PERIOD_MS / st.taken, "\n\r");
+    }
+}
+
+/**
+ * Imprime una decision del regulador de sample_period.
+ */
+void s__report_governor( const governor_decision* d )
+{
+    static const char* const reasons[] = { "overrun", "cola", "latencia", "holgura" };
+    messages_print("Governor: ");
+    messages_print(reasons[d->reason]);
+    messages_print_int(", sample period ", d->from, "");
+    messages_print_int(" -> ", d->to, "\n\r");
+    messages_print_int("  ocupacion [%]: ", d->occupancy, "\n\r");
+    messages_print_int("  latencia [ms]: ", d->latency_ms, "\n\r");
+    messages_print_int("  t [ms]: ", d->time_ms, "\n\r");
+}
+
+/**
+ * Manda por Bluetooth el encabezado APP_CAPTURE_HDR_SIZE de la ventana
+ * capturada.
+ */
+void s__send_capture_hdr( app_type* app )
+{
+    const capture_type* cap = &app->capture;
+    const uint32_t tstamp = cap->trig_tstamp;
+    const uint32_t period_us = app->config.sample_period_us;
+    uint8_t out[APP_CAPTURE_HDR_SIZE];
+    out[0]  = cap->pre;
+    out[1]  = cap->pre >> 8;
+    out[2]  = cap->post;
+    out[3]  = cap->post >> 8;
+    out[4]  = tstamp;
+    out[5]  = tstamp >> 8;
+    out[6]  = tstamp >> 16;
+    out[7]  = tstamp >> 24;
+    out[8]  = period_us;
+    out[9]  = period_us >> 8;
+    out[10] = period_us >> 16;
+    out[11] = period_us >> 24;
+    bluetooth_write_buf(out, APP_CAPTURE_HDR_SIZE);
+}
+
+/**
+ * Pasa las 'n' muestras de un buffer por el procesamiento de APP_PROC_MODE y
+ * manda por Bluetooth lo que haya terminado.  Devuelve true si mando algo.
+ */
+bool s__proc_update( app_type* app, const uint8_t* samples, unsigned n )
+{
+    bool sent = false;
+
+#if APP_PROC_MODE == APP_PROC_FFT
+    for (unsigned i = 0; i < n; ++i)
+    {
+        if (!spectrum_push(&app->spectrum, samples[i]))
+            continue;
+
+        const unsigned n_bins = spectrum_bins(&app->spectrum, app->spectrum_out);
+        bluetooth_write(n_bins);
+        bluetooth_write(n_bins >> 8);
+        for (unsigned k = 0; k < n_bins; ++k)
+        {
+            bluetooth_write(app->spectrum_out[k]);
+            bluetooth_write(app->spectrum_out[k] >> 8);
+        }
+        sent = true;
+    }
+#elif APP_PROC_MODE == APP_PROC_SUMMARY
+    summary_record rec;
+    uint8_t out[SUMMARY_RECORD_SIZE];
+    bool done;
+    while (n > 0)
+    {
+        unsigned used = summary_push(&app->summary, samples, n, &rec, &done);
+        samples += used;
+        n       -= used;
+        if (done)
+        {
+            summary_encode(&rec, out);
+            bluetooth_write_buf(out, SUMMARY_RECORD_SIZE);
+            sent = true;
+        }
+    }
+#elif APP_PROC_MODE == APP_PROC_CODEC
+    for (unsigned i = 0; i < n; ++i)
+    {
+        app->codec_in[app->codec_n++] = samples[i];
+        if (app->codec_n < APP_CODEC_BLOCK)
+            continue;
+
+        unsigned len = codec_encode(APP_CODEC, app->codec_in, APP_CODEC_BLOCK, app->codec_out);
+        bluetooth_write_buf(app->codec_out, len);
+        app->codec_n = 0;
+        sent = true;
+    }
+#elif APP_PROC_MODE == APP_PROC_GOERTZEL
+    const unsigned n_tones = app->goertzel.tones.n;
+    uint16_t amps[GOERTZEL_TONES_MAX];
+    uint8_t out[APP_GOERTZEL_HDR_SIZE + 2 * GOERTZEL_TONES_MAX];
+    bool done;
+    while (n > 0)
+    {
+        unsigned used = goertzel_push(&app->goertzel, samples, n, amps, &done);
+        samples += used;
+        n       -= used;
+        if (!done || n_tones == 0)
+            continue;
+
+        out[0] = n_tones;
+        for (unsigned t = 0; t < n_tones; ++t)
+        {
+            out[APP_GOERTZEL_HDR_SIZE + 2*t]     = amps[t];
+            out[APP_GOERTZEL_HDR_SIZE + 2*t + 1] = amps[t] >> 8;
+        }
+        bluetooth_write_buf(out, APP_GOERTZEL_HDR_SIZE + 2 * n_tones);
+        sent = true;
+    }
+#elif APP_PROC_MODE == APP_PROC_EVENTS
+    // En app_type y no en la pila de vTaskApp.
+    event_record* const recs = app->events_recs;
+    uint8_t* const out = app->events_out;
+    while (n > 0)
+    {
+        unsigned n_recs;
+        unsigned used = events_push(&app->events, samples, n, recs, APP_EVENTS_MAX, &n_recs);
+        samples += used;
+        n       -= used;
+        if (n_recs == 0)
+            continue;
+
+        for (unsigned i = 0; i < n_recs; ++i)
+            events_encode(&recs[i], &out[i * EVENTS_RECORD_SIZE]);
+        bluetooth_write_buf(out, n_recs * EVENTS_RECORD_SIZE);
+        sent = true;
+    }
+#endif
+
+    return sent;
+}
+
+/**
+ * Evalua el regulador despues de enviar un buffer, con la latencia de la
+ * respuesta Bluetooth en ms.  Si cambia el periodo lo avisa como las teclas.
+ */
+void s__governor_update( app_type* app, uint32_t latency_ms )
+{
+#if APP_ADC_MODE == APP_ADC_MODE_STREAM
+    const StreamBufferHandle_t sb = app->adc_stream.sb;
+    const unsigned occupancy = xStreamBufferBytesAvailable(sb) * 100UL / (sizeof(buffer_queue_mem) - 1);
+    const uint32_t losses = app->adc_stream.dropped;
+#else
+    const buffer_queue* bq = &app->data_queue;
+    const unsigned occupancy = buffer_queue_inuse_count(&app->data_queue) * 100UL / bq->n_elems;
+    app_overrun ov;
+    app_get_overrun(app, &ov);
+    // Diezmar es la forma de no perder buffers, no cuenta como perdida.
+    const uint32_t losses = ov.dropped_oldest + ov.dropped_newest;
+#endif
+    const bool overrun = losses != app->governor_losses;
+    app->governor_losses = losses;
+
+    // Si se cambio el periodo con las teclas, el regulador parte de ese.
+    // config.sample_period no se toca aca: es lo que se guarda en la SD.
+    const unsigned keys = app->config.sample_period;
+    if (keys != app->governor_keys)
+    {
+        app->governor_keys = keys;
+        app->governor_period = keys;
+        xSemaphoreGive(app->semaphore_config);
+    }
+
+    const uint32_t now_ms = xTaskGetTickCount() * portTICK_PERIOD_MS;
+    const unsigned period = app->governor_period;
+    const unsigned next = governor_update(&app->governor, period, occupancy,
+                                          latency_ms, overrun, now_ms);
+    if (next != period)
+    {
+        app->governor_period = next;
+        xSemaphoreGive(app->semaphore_config);
+
+        governor_decision d;
+        if (governor_last(&app->governor, &d))
+            s__report_governor(&d);
+    }
+}
+
+/**
+ * Reserva el DMA y arma el formato de los buffers segun APP_ADC_MODE.
+ * Devuelve -1 si no hay canales de DMA disponibles.
+ */
+int s__adc_dma_setup( app_type* app )
+{
+    adc_dma_type* ad = &app->adc_dma;
+    int ret;
+
+#if APP_ADC_MODE == APP_ADC_MODE_SCAN
+    const uint8_t mask = APP_ADC_SCAN_MASK;
+    adc_dma_init(ad, &app->data_queue);
+    ret = adc_hw_dma_setup(mask);
+
+    // Solo barridos completos en cada frame.
+    unsigned n_chn = 0;
+    for (uint8_t m = mask; m != 0; m >>= 1)
+        n_chn += m & 1;
+    uint8_t hdr[APP_SCAN_HDR_SIZE];
+    hdr[0] = mask;
+    hdr[1] = ((APP_DATA_BUF_SIZE - APP_SCAN_HDR_SIZE) / n_chn) * n_chn;
+    adc_dma_set_frame(ad, hdr, APP_SCAN_HDR_SIZE, hdr[1]);
+#elif APP_ADC_MODE == APP_ADC_MODE_DUAL
+    adc_dma_init(ad, &app->data_queue);
+    ret = adc_hw_dma_setup_dual(APP_ADC_DUAL_CHANNEL0, APP_ADC_DUAL_CHANNEL1);
+
+    // La marca de tiempo la completa adc_dma en cada buffer.
+    uint8_t hdr[APP_DUAL_HDR_SIZE] = { 0 };
+    hdr[0] = APP_ADC_DUAL_OFFSET ? APP_DUAL_FLAG_OFFSET : 0;
+    hdr[1] = APP_ADC_DUAL_CHANNEL0 | (APP_ADC_DUAL_CHANNEL1 << 4);
+    hdr[2] = (APP_DATA_BUF_SIZE - APP_DUAL_HDR_SIZE) / 2;
+    adc_dma_set_frame(ad, hdr, APP_DUAL_HDR_SIZE, 2 * hdr[2]);
+    adc_dma_set_timestamp(ad, APP_DUAL_HDR_TSTAMP);
+#else
+    adc_dma_init(ad, &app->data_queue);
+    ret = adc_hw_dma_setup(1 << APP_ADC_CHANNEL);
+#endif
+
+    return ret;
+}
+
+/**
+ * Arranca o reprograma el disparo del ADC segun APP_ADC_MODE.
+ */
+void s__adc_dma_trigger( app_type* app )
+{
+    adc_dma_type* ad = &app->adc_dma;
+
+#if APP_ADC_MODE == APP_ADC_MODE_TIMER
+    const uint32_t period_us = app->config.sample_period_us;
+    adc_dma_set_period(ad, period_us, ad->len);
+    adc_timer_start(APP_ADC_CHANNEL, period_us);
+#elif APP_ADC_MODE == APP_ADC_MODE_SCAN
+    adc_dma_set_period(ad, 1000000UL / APP_ADC_SCAN_RATE, ad->len);
+    adc_scan_start(APP_ADC_SCAN_MASK, APP_ADC_SCAN_RATE);
+#elif APP_ADC_MODE == APP_ADC_MODE_DUAL
+    const uint32_t period_us = app->config.sample_period_us;
+    // Con desfasaje la secuencia intercalada tiene una muestra cada medio
+    // periodo; sin el, cada buffer abarca solo las n muestras de un ADC.
+    if (APP_ADC_DUAL_OFFSET)
+        adc_dma_set_period(ad, period_us / 2, ad->len);
+    else
+        adc_dma_set_period(ad, period_us, ad->len / 2);
+    adc_dual_start(APP_ADC_DUAL_CHANNEL0, APP_ADC_DUAL_CHANNEL1, period_us, APP_ADC_DUAL_OFFSET);
+#else
+    adc_dma_set_period(ad, 1000000UL / APP_ADC_DMA_RATE, ad->len);
+    adc_burst_start(APP_ADC_CHANNEL, APP_ADC_DMA_RATE);
+#endif
+}
+
+/**
+ * Lee una muestra de APP_ADC_BITS bits.  Con el front-end es la ultima salida
+ * del decimador, que ya tomo vTaskADCCIC.
+ */
+uint16_t s__adc_read( app_type* app )
+{
+#if APP_ADC_CIC_ORDER > 0
+    return app->frontend_out;
+#elif APP_ADC_BITS == 10
+    return adc_read10(APP_ADC_CHANNEL);
+#else
+    return adc_read(APP_ADC_CHANNEL);
+#endif
+}
+
+/**
+ * Indice del periodo de muestreo pedido: el de la config o, con APP_GOVERNOR,
+ * el que eligio el regulador.
+ */
+unsigned s__sample_period( const app_type* app )
+{
+#if APP_GOVERNOR
+    return app->governor_period;
+#else
+    return app->config.sample_period;
+#endif
+}
+
+/**
+ * Indice del periodo de muestreo del ADC.  Con remuestreo sample_period es el
+ * de la salida y el ADC va siempre a la tasa mas alta.
+ */
+unsigned s__adc_sample_period( const app_type* app )
+{
+#if APP_RESAMPLE_USED
+    (void) app;
+    return APP_ADC_MIN_RATE;
+#else
+    return s__sample_period(app);
+#endif
+}
+
+/**
+ * Periodo de muestreo de vTaskADC en us.
+ */
+uint32_t s__poll_period_us( const app_type* app )
+{
+    return (s__adc_sample_period(app)+1) * 10000UL * DBG_PERIOD_MULTIPLIER;
+}
+
+/**
+ * Periodo en us de las muestras que llegan al procesamiento, despues del
+ * diezmado del filtro y del remuestreo.
+ */
+uint32_t s__proc_period_us( const app_type* app )
+{
+#if APP_ADC_MODE == APP_ADC_MODE_TIMER
+    uint32_t period_us = app->config.sample_period_us;
+#elif APP_ADC_MODE == APP_ADC_MODE_DMA
+    uint32_t period_us = 1000000UL / APP_ADC_DMA_RATE;
+#else
+    uint32_t period_us = s__poll_period_us(app);
+#endif
+#if APP_FILTER_USED
+    period_us *= app->filter.decim;
+#endif
+#if APP_RESAMPLE_USED
+    period_us = period_us * app->resample.down / app->resample.up;
+#endif
+    return period_us;
+}
+
+/**
+ * Vuelve a llenar el buffer actual desde el principio, para que cada buffer
+ * tenga un solo periodo de muestreo.
+ */
+void s__restart_buffer( app_type* app )
+{
+    app->samples_in_buffer = 0;
+    app->n_pack = 0;
+}
+
+/**
+ * Lee el filtro de APP_SD_FILTER_FILENAME y se lo pasa a la tarea APP.  Sin
+ * archivo no se filtra.
+ */
+void s__load_filter( app_type* app )
+{
+    uint8_t data[FILTER_FILE_MAX];
+    int n = config_read_file(APP_SD_FILTER_FILENAME, data, sizeof(data));
+    if (n < 0)
+    {
+        messages_print("Filter: sin archivo, no se filtra\n\r");
+        return;
+    }
+
+    if (filter_parse(&app->filter_new, data, n) < 0)
+    {
+        messages_print("ERROR: archivo del filtro invalido\n\r");
+    }
+    else if (APP_DATA_BUF_SIZE % app->filter_new.decim != 0)
+    {
+        messages_print("ERROR: el diezmado del filtro no divide al buffer\n\r");
+        filter_init(&app->filter_new);
+    }
+    else
+    {
+        messages_print_int("Filter: tipo ", app->filter_new.type, "");
+        messages_print_int(", n ", app->filter_new.n, "");
+        messages_print_int(", diezmado ", app->filter_new.decim, "\n\r");
+    }
+    xSemaphoreGive(app->semaphore_filter);
+}
+
+/**
+ * Lee la calibracion de APP_SD_CALIB_FILENAME y se la pasa a la tarea APP.
+ * Sin archivo quedan las cuentas crudas.
+ */
+void s__load_calib( app_type* app )
+{
+    uint8_t data[CALIB_FILE_MAX];
+    int n = config_read_file(APP_SD_CALIB_FILENAME, data, sizeof(data));
+    if (n < 0)
+    {
+        messages_print("Calib: sin archivo, no se calibra\n\r");
+        return;
+    }
+
+    n = calib_parse(app->calib_new, data, n);
+    if (n < 0)
+        messages_print("ERROR: archivo de calibracion invalido\n\r");
+    else
+        messages_print_int("Calib: canales ", n, "\n\r");
+    xSemaphoreGive(app->semaphore_calib);
+}
+
+#if APP_PROC_MODE == APP_PROC_GOERTZEL
+/**
+ * Lee los tonos de APP_SD_TONES_FILENAME y se los pasa a la tarea APP.  Sin
+ * archivo no se manda nada.
+ */
+void s__load_tones( app_type* app )
+{
+    uint8_t data[GOERTZEL_FILE_MAX];
+    int n = config_read_file(APP_SD_TONES_FILENAME, data, sizeof(data));
+    if (n < 0)
+    {
+        messages_print("Goertzel: sin archivo de tonos\n\r");
+        return;
+    }
+
+    n = goertzel_parse(&app->goertzel_new, data, n);
+    if (n < 0)
+        messages_print("ERROR: archivo de tonos invalido\n\r");
+    else
+        messages_print_int("Goertzel: tonos ", n, "\n\r");
+    xSemaphoreGive(app->semaphore_tones);
+}
+#endif
+
+/**
+ * Calibra en el lugar las muestras de 'buf' segun el formato de APP_ADC_MODE.
+ * En los modos de un canal el buffer tiene 'n' muestras.
+ */
+void s__calibrate( app_type* app, uint8_t* buf, unsigned n )
+{
+#if APP_ADC_MODE == APP_ADC_MODE_SCAN
+    (void) n;
+    calib_apply_scan(&app->calib, buf[0], &buf[APP_SCAN_HDR_SIZE], buf[1]);
+#elif APP_ADC_MODE == APP_ADC_MODE_DUAL
+    (void) n;
+    const unsigned n_adc = buf[2];
+    calib_apply(&app->calib, APP_ADC_DUAL_CHANNEL0, &buf[APP_DUAL_HDR_SIZE], n_adc);
+    calib_apply(&app->calib, APP_ADC_DUAL_CHANNEL1, &buf[APP_DUAL_HDR_SIZE + n_adc], n_adc);
+#elif APP_ADC_MODE == APP_ADC_MODE_CAPTURE
+    (void) n;
+    calib_apply(&app->calib, APP_ADC_CHANNEL, buf, APP_CAPTURE_PRE + APP_CAPTURE_POST);
+#else
+    calib_apply(&app->calib, APP_ADC_CHANNEL, buf, n);
+#endif
+}
+
+/**
+ * Manda por Bluetooth el encabezado APP_BUF_HDR del buffer 'buf', seguido por
+ * 'n' bytes.
+ */
+void s__send_buf_hdr( app_type* app, const uint8_t* buf, unsigned n )
+{
+#if APP_ADC_MODE == APP_ADC_MODE_POLL
+    int idx = buffer_queue_index(&app->data_queue, buf);
+    if (idx < 0)
+        return;
+
+    const app_buf_hdr* h = &app->buf_hdr[idx];
+#else
+    // Los anota la interrupcion del DMA al entregarlo.
+    const adc_dma_buf_info* h = adc_dma_get_info(&app->adc_dma, buf);
+    if (h == NULL)
+        return;
+#endif
+#if APP_FILTER_USED
+    uint32_t period_us = h->period_us * app->filter.decim;
+#else
+    uint32_t period_us = h->period_us;
+#endif
+#if APP_RESAMPLE_USED
+    period_us = period_us * app->resample.down / app->resample.up;
+#endif
+    const uint32_t tstamp = buffer_queue_get_meta(&app->data_queue, buf);
+    const uint32_t fields[3] = { tstamp, period_us, h->dropped };
+    uint8_t out[APP_BUF_HDR_SIZE];
+    out[0] = h->seq;
+    out[1] = h->seq >> 8;
+    for (unsigned i = 0; i < 3; ++i)
+    {
+        out[2 + 4*i + 0] = fields[i];
+        out[2 + 4*i + 1] = fields[i] >> 8;
+        out[2 + 4*i + 2] = fields[i] >> 16;
+        out[2 + 4*i + 3] = fields[i] >> 24;
+    }
+    out[14] = n;
+    out[15] = n >> 8;
+    bluetooth_write_buf(out, APP_BUF_HDR_SIZE);
+}
+
 
 void app_update( app_type* app )
 {
@@ -78,25 +642,176 @@ void app_update( app_type* app )
         app->accel[2] = new_accel[2];
     }
 
+#if APP_CALIB_USED
+    // Calibracion nueva, se arman las tablas aca para no cambiarlas a mitad
+    // de un buffer.
+    if (xSemaphoreTake(app->semaphore_calib, 0))
+        calib_build(&app->calib, app->calib_new);
+#endif
+
+#if APP_FILTER_USED
+    // Filtro nuevo, se cambia entre buffers y arranca sin estado.
+    if (xSemaphoreTake(app->semaphore_filter, 0))
+        app->filter = app->filter_new;
+#endif
+
+#if APP_RESAMPLE_USED
+    // sample_period elige la tasa de salida.  La relacion se cambia aca, entre
+    // buffers, asi el encabezado del buffer ya tiene el periodo nuevo.
+    if (s__sample_period(app) != app->resample_period)
+    {
+        app->resample_period = s__sample_period(app);
+        app_set_resample_ratio(app, APP_ADC_MIN_RATE + 1, app->resample_period + 1);
+    }
+    resample_sync(&app->resample);
+#endif
+
+#if APP_PROC_MODE == APP_PROC_GOERTZEL
+    // Con tonos nuevos o con otra tasa de muestreo se recalculan los
+    // coeficientes, y la ventana vuelve a empezar.
+    const uint32_t proc_period_us = s__proc_period_us(app);
+    if (xSemaphoreTake(app->semaphore_tones, 0))
+        goertzel_set_tones(&app->goertzel, &app->goertzel_new, proc_period_us);
+    else if (proc_period_us != app->goertzel_period_us)
+        goertzel_set_tones(&app->goertzel, &app->goertzel.tones, proc_period_us);
+    app->goertzel_period_us = proc_period_us;
+#endif
+
     // Pedimos un buffer lleno con muestras del ADC.
     // El timeout esta por si las dudas, si las cosas andan bien y no le paso
     // nada raro a la tarea del ADC siempre vamos a tener datos para procesar.
     const TickType_t timeout = pdMS_TO_TICKS(1000UL * DBG_PERIOD_MULTIPLIER);
+#if APP_ADC_MODE == APP_ADC_MODE_STREAM
+    // No hay tarea del ADC, la reprogramacion del timer la hacemos aca.
+    if (xSemaphoreTake(app->semaphore_config, 0))
+        adc_stream_start(&app->adc_stream, APP_ADC_CHANNEL, s__poll_period_us(app));
+
+    // Nos despierta el stream buffer recien cuando hay un buffer completo.
+    uint8_t stream_buf[APP_DATA_BUF_SIZE];
+    uint8_t* buf = stream_buf;
+    if (adc_stream_read(&app->adc_stream, buf, APP_DATA_BUF_SIZE, timeout) != APP_DATA_BUF_SIZE)
+        buf = NULL;
+#elif APP_ADC_MODE == APP_ADC_MODE_CAPTURE
+    if (xSemaphoreTake(app->semaphore_config, 0))
+        capture_start(&app->capture, APP_ADC_CHANNEL, app->config.sample_period_us);
+
+    // Solo hay datos cuando se disparo y se completo la ventana.
+    uint8_t* buf = capture_wait(&app->capture, timeout);
+#else
     uint8_t* buf = buffer_queue_get_inuse(&app->data_queue, timeout);
+#endif
 
     if (buf != NULL)
     {
-        float mult = app->accel[0];
-        //mult = 1.0;
-        for (unsigned i = 0; i < APP_DATA_BUF_SIZE; ++i)
-            bluetooth_write(buf[i] * mult);
-        buffer_queue_return(&app->data_queue, buf);
+        unsigned first = 0;
+#if APP_ADC_MODE == APP_ADC_MODE_STREAM || APP_ADC_MODE == APP_ADC_MODE_CAPTURE
+        unsigned last  = APP_DATA_BUF_SIZE;
+#else
+        // Puede venir a medio llenar por APP_FLUSH_MS.
+        unsigned last  = buffer_queue_len(&app->data_queue, buf);
+        uint8_t* const shared = buf;  // El del buffer_queue, para devolverlo
+#endif
+#if APP_SINK_UART
+        // El buffer lo tiene tambien vTaskSinkUart, todo lo que sigue escribe
+        // sobre las muestras asi que trabajamos sobre una copia.
+        uint8_t work[APP_DATA_BUF_SIZE];
+        memcpy(work, shared, last);
+        buf = work;
+#endif
+#if APP_CALIB_USED
+        s__calibrate(app, buf, last);
+#endif
+#if APP_ADC_MODE == APP_ADC_MODE_CAPTURE
+        s__send_capture_hdr(app);
+        last = APP_CAPTURE_PRE + APP_CAPTURE_POST;
+#endif
+#if APP_ADC_MODE == APP_ADC_MODE_SCAN
+        // El encabezado del frame va tal cual y solo se mandan las muestras
+        // validas, no el relleno del final.
+        for (; first < APP_SCAN_HDR_SIZE; ++first)
+            bluetooth_write(buf[first]);
+        last = first + buf[1];
+#endif
 
-        const TickType_t bluetooth_timeout = pdMS_TO_TICKS(APP_BLUETOOTH_TIMEOUT);
-        if (xSemaphoreTake(app->semaphore_reply, bluetooth_timeout) != pdTRUE)
+#if APP_ADC_MODE == APP_ADC_MODE_DUAL
+        // El buffer tiene primero todas las muestras del ADC0 y despues las
+        // del ADC1, las mandamos intercaladas en un solo flujo.
+        for (; first < APP_DUAL_HDR_SIZE; ++first)
+            bluetooth_write(buf[first]);
+        const unsigned n = buf[2];
+        scale_apply(&buf[first], &buf[first], 2 * n, scale_gain_from_float(app->accel[0]));
+        for (unsigned i = 0; i < n; ++i)
         {
-            // Timeout
-            xSemaphoreGive(app->semaphore_error);
+            bluetooth_write(buf[first + i]);
+            bluetooth_write(buf[first + n + i]);
+        }
+        last = first;
+#endif
+
+#if APP_ADC_BITS == 10
+#if APP_BUF_HDR_USED
+        s__send_buf_hdr(app, shared, last);
+#endif
+        // Escalamos cada grupo desempaquetado, saturando a 10 bits, y lo
+        // volvemos a empaquetar para mandarlo.
+        uint16_t group[PACK10_GROUP];
+        uint8_t  packed[PACK10_BYTES];
+        const float pack_mult = app->accel[0];
+        for (; first < last; first += PACK10_BYTES)
+        {
+            pack10_decode(&buf[first], PACK10_GROUP, group);
+            for (unsigned j = 0; j < PACK10_GROUP; ++j)
+            {
+                float v = group[j] * pack_mult;
+                group[j] = (v < 0) ? 0 : (v > 1023) ? 1023 : v;
+            }
+            pack10_encode(group, PACK10_GROUP, packed);
+            for (unsigned j = 0; j < PACK10_BYTES; ++j)
+                bluetooth_write(packed[j]);
+        }
+        last = first;
+#endif
+
+#if APP_FILTER_USED
+        last = first + filter_apply(&app->filter, &buf[first], last - first);
+#endif
+#if APP_RESAMPLE_USED
+        last = first + resample_apply(&app->resample, &buf[first], last - first);
+#endif
+
+#if APP_PROC_MODE == APP_PROC_RAW
+        // Escalado en punto fijo con saturacion, sobre el mismo buffer.
+        scale_apply(&buf[first], &buf[first], last - first, scale_gain_from_float(app->accel[0]));
+#if APP_BUF_HDR_USED && APP_ADC_BITS == 8
+        // Recien aca se sabe cuantas muestras quedaron despues del filtro.
+        s__send_buf_hdr(app, shared, last - first);
+#endif
+        bluetooth_write_buf(&buf[first], last - first);
+        const bool sent = true;
+#else
+        const bool sent = s__proc_update(app, &buf[first], last - first);
+#endif
+#if APP_ADC_MODE == APP_ADC_MODE_CAPTURE
+        capture_rearm(&app->capture);
+#elif APP_ADC_MODE != APP_ADC_MODE_STREAM
+        buffer_queue_return(&app->data_queue, shared);
+#endif
+
+        // Si el procesamiento no mando nada no hay respuesta que esperar.
+        if (sent)
+        {
+            const TickType_t bluetooth_timeout = pdMS_TO_TICKS(APP_BLUETOOTH_TIMEOUT);
+#if APP_GOVERNOR
+            const TickType_t sent_time = xTaskGetTickCount();
+#endif
+            if (xSemaphoreTake(app->semaphore_reply, bluetooth_timeout) != pdTRUE)
+            {
+                // Timeout
+                xSemaphoreGive(app->semaphore_error);
+            }
+#if APP_GOVERNOR
+            s__governor_update(app, (xTaskGetTickCount() - sent_time) * portTICK_PERIOD_MS);
+#endif
         }
     }
     else
@@ -105,42 +820,133 @@ void app_update( app_type* app )
     }
 }
 
+/**
+ * Pide un buffer nuevo para adc_update segun la politica de overrun.  Puede
+ * devolver NULL, en tal caso la muestra actual se pierde.
+ */
+uint8_t* s__overrun_get_buffer( app_type* app )
+{
+    app_overrun* ov = &app->overrun;
+    buffer_queue* bq = &app->data_queue;
+    uint8_t* buf = buffer_queue_get_avail(bq, 0);
+
+    if (buf != NULL)
+    {
+        // Con lugar de sobra se vuelve de a un paso hacia la tasa completa.
+        if (ov->decim_shift > 0 && buffer_queue_avail_count(bq) >= bq->n_elems / 2)
+            ov->decim_shift--;
+        return buf;
+    }
+
+    switch (ov->policy)
+    {
+    case APP_OVERRUN_DROP_OLDEST:
+        // Obtenemos el proximo en uso y lo descartamos, seria como hacer una
+        // especie de buffer circular.
+        if (buffer_queue_drop_oldest(bq))
+        {
+            ov->dropped_oldest++;
+        }
+        else
+        {
+            // ERROR
+        }
+        break;
+
+    case APP_OVERRUN_BLOCK:
+        // Esperamos que vTaskApp libere uno, como mucho hasta el plazo.
+        ov->blocked++;
+        buf = buffer_queue_get_avail(bq, pdMS_TO_TICKS(APP_OVERRUN_BLOCK_MS));
+        if (buf == NULL)
+        {
+            ov->block_timeouts++;
+            ov->dropped_newest++;
+        }
+        break;
+
+    case APP_OVERRUN_DECIMATE:
+        // Cada overrun duplica la decimacion, el buffer siguiente ya sale a
+        // la tasa reducida.
+        if (ov->decim_shift < APP_OVERRUN_DECIM_MAX)
+            ov->decim_shift++;
+        ov->dropped_newest++;
+        break;
+
+    default: // APP_OVERRUN_DROP_NEWEST
+        ov->dropped_newest++;
+        break;
+    }
+
+    return buf;
+}
+
 void adc_update( app_type* app )
 {
+    const uint32_t now = tstamp_now();
+    tstamp_jitter_add(&app->jitter, now);
+
     uint8_t* buf = app->current_buffer;
     if (buf == NULL)
     {
         // Tenemos que pedir un buffer nuevo.  Puede que no haya ninguno
-        // disponible si nadie los vacio todavia, en tal caso obtenemos el
-        // proximo en uso y lo descartamos, seria como hacer una especia de
-        // buffer circular.
-        buf = buffer_queue_get_avail(&app->data_queue, 0);
-        if (buf == NULL)
-        {
-            buf = buffer_queue_get_inuse(&app->data_queue, 0);
-            if (buf != NULL)
-            {
-                buffer_queue_return(&app->data_queue, buf);
-                buf = NULL;
-            }
-            else
-            {
-                // ERROR
-            }
-        }
+        // disponible si nadie los vacio todavia, que hacer depende de
+        // app->overrun.policy.
+        buf = s__overrun_get_buffer(app);
         app->samples_in_buffer = 0;
         app->current_buffer = buf;
+        app->overrun.decim_count = 0;
+    }
+
+    // La decimacion solo cambia entre buffers, asi cada uno tiene un periodo.
+    const uint32_t decim_mask = (1UL << app->overrun.decim_shift) - 1;
+    if (buf != NULL && (app->overrun.decim_count++ & decim_mask) != 0)
+    {
+        app->overrun.decimated++;
+        buf = NULL;
     }
 
     if (buf != NULL) // Solo leemos el ADC si tenemos un buffer disponible
     {
-        buf[app->samples_in_buffer++] = adc_read(APP_ADC_CHANNEL);
+        if (app->samples_in_buffer == 0 && app->n_pack == 0)
+        {
+            // Primer muestra del buffer, el resto del encabezado se completa
+            // al entregarlo.
+            int idx = buffer_queue_index(&app->data_queue, buf);
+            buffer_queue_set_meta(&app->data_queue, buf, now);
+            // El periodo que se esta aplicando, la config puede ir adelantada.
+            app->buf_hdr[idx].period_us = app->jitter.nominal << app->overrun.decim_shift;
+        }
+
+#if APP_ADC_BITS == 10
+        // Juntamos un grupo de muestras y lo empaquetamos de una vez.
+        app->pack[app->n_pack++] = s__adc_read(app);
+        if (app->n_pack == PACK10_GROUP)
+        {
+            pack10_encode(app->pack, PACK10_GROUP, &buf[app->samples_in_buffer]);
+            app->samples_in_buffer += PACK10_BYTES;
+            app->n_pack = 0;
+        }
+#else
+        buf[app->samples_in_buffer++] = s__adc_read(app);
+#endif
 
-        if (app->samples_in_buffer == APP_DATA_BUF_SIZE)
+        bool ready = (app->samples_in_buffer == APP_DATA_BUF_USED);
+#if APP_FLUSH_MS > 0
+        // Con tasas bajas no esperamos a llenarlo, pasado el plazo desde la
+        // primer muestra se manda lo que haya (en 10 bits, grupos completos).
+        if (app->samples_in_buffer > 0 && app->n_pack == 0 &&
+            now - buffer_queue_get_meta(&app->data_queue, buf) >= APP_FLUSH_MS * 1000UL)
+            ready = true;
+#endif
+
+        if (ready)
         {
             // Se lleno el buffer actual, enviarlo y marcarlo para pedir uno
             // nuevo en la proxima iteracion.
-            buffer_queue_push(&app->data_queue, buf);
+            int idx = buffer_queue_index(&app->data_queue, buf);
+            app->buf_hdr[idx].seq     = app->buf_seq++;
+            app->buf_hdr[idx].dropped = app->overrun.dropped_oldest;
+            buffer_queue_push_partial(&app->data_queue, buf, app->samples_in_buffer);
             app->current_buffer = NULL;
         }
     }
@@ -196,6 +1002,14 @@ void config_update( app_type* app )
         }
     }
 
+    // Siguiente politica de overrun.
+    if (debouncer_is_edge(&app->button_up) && debouncer_is_hi(&app->button_up))
+    {
+        int policy = (app->overrun.policy + 1) % APP_OVERRUN_N_POLICIES;
+        app_set_overrun_policy(app, policy);
+        messages_print_int("Overrun policy: ", policy, "\n\r");
+    }
+
     if (modify_sample_rate != 0)
     {
         if (modify_sample_rate > 0 && app->config.sample_period < APP_ADC_MAX_RATE)
@@ -214,9 +1028,40 @@ void config_update( app_type* app )
     }
 }
 
+void app_set_overrun_policy( app_type* app, int policy )
+{
+    if (policy < 0 || policy >= APP_OVERRUN_N_POLICIES)
+        return;
+
+    taskENTER_CRITICAL();
+    app->overrun.policy = policy;
+    app->overrun.decim_shift = 0;
+    taskEXIT_CRITICAL();
+}
+
+void app_get_overrun( app_type* app, app_overrun* out )
+{
+    taskENTER_CRITICAL();
+    *out = app->overrun;
+    taskEXIT_CRITICAL();
+}
+
+int app_set_resample_ratio( app_type* app, unsigned up, unsigned down )
+{
+#if APP_RESAMPLE_USED
+    return resample_set_ratio(&app->resample, up, down);
+#else
+    (void) app;
+    (void) up;
+    (void) down;
+    return -1;
+#endif
+}
+
 void app_init( app_type* app )
 {
     Board_Init();
+    tstamp_init();
 
     // Antes que nada inicializamos los mensajes de salida por UART, esto es
     // porque corren en su propia tarea y tienen una FIFO asociada.  Si
@@ -229,71 +1074,182 @@ void app_init( app_type* app )
     bluetooth_init();
     
     // Periodo de muestreo al maximo y el acelerometro en 0
-    app->config.sample_period = 0;
+    config_default(&app->config);
     app->accel[0] = 0.0;
     app->accel[1] = 0.0;
     app->accel[2] = 0.0;
+    app->buf_seq     = 0;
+    memset(&app->overrun, 0, sizeof(app->overrun));
+    app->overrun.policy = APP_OVERRUN_POLICY;
+    governor_init(&app->governor, APP_ADC_MIN_RATE, APP_ADC_MAX_RATE,
+                  APP_GOVERNOR_HI_PCT, APP_GOVERNOR_LO_PCT, APP_GOVERNOR_LATENCY_MS,
+                  APP_GOVERNOR_HOLD_UP, APP_GOVERNOR_HOLD_DOWN);
+    app->governor_losses = 0;
+    app->governor_period = app->config.sample_period;
+    app->governor_keys   = app->config.sample_period;
+    filter_init(&app->filter);
+    filter_init(&app->filter_new);
+    resample_init(&app->resample);
+    app->resample_period = APP_ADC_MIN_RATE;
+    calib_default(app->calib_new);
+    calib_build(&app->calib, app->calib_new);
+#if APP_PROC_MODE == APP_PROC_FFT
+    if (spectrum_init(&app->spectrum, APP_FFT_SIZE, APP_FFT_AVERAGE) < 0)
+        messages_print("ERROR: tamano de la FFT\n\r");
+#elif APP_PROC_MODE == APP_PROC_SUMMARY
+    if (summary_init(&app->summary, APP_SUMMARY_SIZE) < 0)
+        messages_print("ERROR: tamano del resumen\n\r");
+#elif APP_PROC_MODE == APP_PROC_CODEC
+    app->codec_n = 0;
+#elif APP_PROC_MODE == APP_PROC_GOERTZEL
+    if (goertzel_init(&app->goertzel, APP_GOERTZEL_SIZE) < 0)
+        messages_print("ERROR: tamano de la ventana de Goertzel\n\r");
+    app->goertzel_new.n = 0;
+    app->goertzel_period_us = 0;
+    app->semaphore_tones = xSemaphoreCreateBinaryStatic(&app->semaphore_tones_static);
+#elif APP_PROC_MODE == APP_PROC_EVENTS
+    if (events_init(&app->events, APP_EVENTS_PROMINENCE, APP_EVENTS_LEVEL, APP_EVENTS_HYST,
+                    APP_EVENTS_LO, APP_EVENTS_HI, APP_EVENTS_MIN_RUN) < 0)
+        messages_print("ERROR: parametros del detector de eventos\n\r");
+#endif
 
     // Inicializamos los semaforos y listas.
-    app->semaphore_config = xSemaphoreCreateBinary();
-    app->semaphore_error  = xSemaphoreCreateBinary();
-    app->semaphore_reply  = xSemaphoreCreateBinary();
-    app->queue_mpu        = xQueueCreate(1, sizeof(float[3]));
+    app->semaphore_config = xSemaphoreCreateBinaryStatic(&app->semaphore_config_static);
+    app->semaphore_error  = xSemaphoreCreateBinaryStatic(&app->semaphore_error_static);
+    app->semaphore_reply  = xSemaphoreCreateBinaryStatic(&app->semaphore_reply_static);
+    app->semaphore_filter = xSemaphoreCreateBinaryStatic(&app->semaphore_filter_static);
+    app->semaphore_calib  = xSemaphoreCreateBinaryStatic(&app->semaphore_calib_static);
+    app->queue_mpu        = xQueueCreateStatic(1, sizeof(float[3]), app->queue_mpu_mem, &app->queue_mpu_static);
 
+#if APP_ADC_MODE == APP_ADC_MODE_STREAM
+    // El stream buffer usa la memoria de los buffers (necesita un byte extra)
+    // y solo despierta a vTaskApp cuando junto un buffer completo.
+    if (adc_stream_init( &app->adc_stream,
+                         buffer_queue_mem,
+                         sizeof(buffer_queue_mem) - 1,
+                         APP_DATA_BUF_SIZE ) < 0)
+        messages_print("ERROR: crear el stream buffer del ADC\n\r");
+#elif APP_ADC_MODE == APP_ADC_MODE_CAPTURE
+    // La ventana de captura usa la memoria de los buffers.
+    if (capture_init( &app->capture,
+                      buffer_queue_mem,
+                      sizeof(buffer_queue_mem),
+                      APP_CAPTURE_PRE,
+                      APP_CAPTURE_POST ) < 0)
+        messages_print("ERROR: ventana de captura\n\r");
+    capture_set_trigger(&app->capture, APP_CAPTURE_LEVEL, APP_CAPTURE_EDGE, APP_CAPTURE_SLOPE);
+#else
     // Inicializamos la lista de buffers.
-    buffer_queue_init( &app->data_queue,
-                       buffer_queue_mem,
-                       APP_DATA_BUF_SIZE,
-                       APP_DATA_BUF_NMBR );
+    if (buffer_queue_init( &app->data_queue,
+                           buffer_queue_mem,
+                           APP_DATA_BUF_SIZE,
+                           APP_DATA_BUF_NMBR ) < 0)
+        messages_print("ERROR: crear la lista de buffers\n\r");
+#if APP_SINK_UART
+    // Antes de crear la tarea del ADC, los buffers entregados antes no le
+    // llegarian.
+    app->sink_uart = buffer_queue_add_consumer(&app->data_queue);
+    if (app->sink_uart < 0)
+        messages_print("ERROR: agregar el consumidor de la UART\n\r");
+#endif
+#endif
 
     // Iniciamos todas las tareas, estan ordenadas por prioridad.
-    xTaskCreate( vTaskADC,
+#if APP_ADC_MODE == APP_ADC_MODE_STREAM || APP_ADC_MODE == APP_ADC_MODE_CAPTURE
+    // Sin tarea del ADC, las muestras las escribe la interrupcion.
+#elif APP_ADC_USES_DMA
+    // Los buffers los mueve la interrupcion, pero si el DMA se detiene tiene
+    // que rearrancarlo cuanto antes, por eso va por encima de la tarea que
+    // escribe por Bluetooth.
+    APP_TASK_CREATE( vTaskADCDMA,
+                 (const char*) "Task ADC DMA",
+                 configMINIMAL_STACK_SIZE,
+                 app,
+                 tskIDLE_PRIORITY+4,
+                 NULL );
+#elif APP_ADC_CIC_ORDER > 0
+    // Como vTaskADCDMA, tiene que tomar cada salida del decimador a tiempo.
+    APP_TASK_CREATE( vTaskADCCIC,
+                 (const char*) "Task ADC CIC",
+                 configMINIMAL_STACK_SIZE,
+                 app,
+                 tskIDLE_PRIORITY+4,
+                 NULL );
+#else
+    APP_TASK_CREATE( vTaskADC,
                  (const char*) "Task ADC",
                  configMINIMAL_STACK_SIZE,
                  app,
                  tskIDLE_PRIORITY+1,
                  NULL );
+#endif
 
-    xTaskCreate( vTaskApp,
+    APP_TASK_CREATE( vTaskApp,
                  (const char*) "Task APP",
                  configMINIMAL_STACK_SIZE,
                  app,
                  tskIDLE_PRIORITY+2,
                  NULL );
 
-    xTaskCreate( vTaskBluetooth,
+    APP_TASK_CREATE( vTaskBluetooth,
                  (const char*) "Task Bluetooth",
                  configMINIMAL_STACK_SIZE,
                  app,
                  tskIDLE_PRIORITY+2,
                  NULL );
 
-    xTaskCreate( vTaskConfig,
+    APP_TASK_CREATE( vTaskConfig,
                  (const char*) "Task Config",
                  configMINIMAL_STACK_SIZE*2,
                  app,
                  tskIDLE_PRIORITY+3,
                  NULL );
 
-    xTaskCreate( vTaskError,
+    APP_TASK_CREATE( vTaskError,
                  (const char*) "Task Error",
                  configMINIMAL_STACK_SIZE,
                  app,
                  tskIDLE_PRIORITY+3,
                  NULL );
 
-    xTaskCreate( vTaskMPU,
+    APP_TASK_CREATE( vTaskMPU,
                  (const char*) "Task MPU",
                  configMINIMAL_STACK_SIZE,
                  app,
                  tskIDLE_PRIORITY+4,
                  NULL );
+
+#if APP_SINK_UART
+    // Por debajo de vTaskApp, si se atrasa solo retiene buffers.
+    APP_TASK_CREATE( vTaskSinkUart,
+                 (const char*) "Task Sink UART",
+                 configMINIMAL_STACK_SIZE,
+                 app,
+                 tskIDLE_PRIORITY+1,
+                 NULL );
+#endif
 }
 
 
 void vTaskApp( void *pParam )
 {
     app_type* pApp = pParam;
+
+#if APP_BENCH
+    bench_init();
+    bench_codec(APP_CODEC_BLOCK);
+    bench_scale(APP_DATA_BUF_SIZE);
+    bench_goertzel(APP_FFT_SIZE, GOERTZEL_TONES_MAX / 2);
+    bench_buffer_queue(1000);
+#endif
+
+#if APP_ADC_MODE == APP_ADC_MODE_STREAM
+    adc_init();
+    adc_stream_start(&pApp->adc_stream, APP_ADC_CHANNEL, s__poll_period_us(pApp));
+#elif APP_ADC_MODE == APP_ADC_MODE_CAPTURE
+    adc_init();
+    capture_start(&pApp->capture, APP_ADC_CHANNEL, pApp->config.sample_period_us);
+#endif
     
     while (1)
     {
@@ -304,11 +1260,15 @@ void vTaskApp( void *pParam )
 void vTaskADC( void *pParam )
 {
     app_type* pApp = pParam;
-    TickType_t xTaskDelay = pdMS_TO_TICKS((pApp->config.sample_period+1)*10 * DBG_PERIOD_MULTIPLIER);
+    TickType_t xTaskDelay = pdMS_TO_TICKS((s__adc_sample_period(pApp)+1)*10 * DBG_PERIOD_MULTIPLIER);
     TickType_t xLastWakeTime = xTaskGetTickCount();
+    TickType_t xLastReport = xLastWakeTime;
 
     adc_init();
+    adc_set_resolution(APP_ADC_BITS);
     pApp->current_buffer = NULL;
+    pApp->n_pack = 0;
+    tstamp_jitter_reset(&pApp->jitter, s__poll_period_us(pApp));
     
     while (1)
     {
@@ -317,13 +1277,100 @@ void vTaskADC( void *pParam )
         if (xSemaphoreTake(pApp->semaphore_config, 0))
         {
             // Nueva configuracion
-            xTaskDelay = pdMS_TO_TICKS((pApp->config.sample_period+1)*10 * DBG_PERIOD_MULTIPLIER);
+            xTaskDelay = pdMS_TO_TICKS((s__adc_sample_period(pApp)+1)*10 * DBG_PERIOD_MULTIPLIER);
+            tstamp_jitter_reset(&pApp->jitter, s__poll_period_us(pApp));
+            s__restart_buffer(pApp);
+        }
+
+        if (xLastWakeTime - xLastReport >= pdMS_TO_TICKS(APP_JITTER_REPORT_PERIOD))
+        {
+            s__report_jitter(&pApp->jitter);
+            s__report_overrun(pApp);
+            tstamp_jitter_reset(&pApp->jitter, pApp->jitter.nominal);
+            xLastReport = xLastWakeTime;
         }
 
         vTaskDelayUntil(&xLastWakeTime, xTaskDelay);
     }
 }
 
+void vTaskADCCIC( void *pParam )
+{
+    app_type* pApp = pParam;
+    // Por si se corta el timer, para no quedar bloqueados para siempre.
+    const TickType_t xTimeout = pdMS_TO_TICKS(1000UL);
+    TickType_t xLastReport = xTaskGetTickCount();
+
+    adc_init();
+    pApp->current_buffer = NULL;
+    pApp->n_pack = 0;
+    if (frontend_init(&pApp->frontend, APP_ADC_CIC_ORDER, APP_ADC_CIC_LOG2_RATIO, APP_ADC_BITS) < 0)
+        messages_print("ERROR: parametros del CIC\n\r");
+    frontend_start(&pApp->frontend, APP_ADC_CHANNEL, s__poll_period_us(pApp));
+    tstamp_jitter_reset(&pApp->jitter, s__poll_period_us(pApp));
+
+    while (1)
+    {
+        if (frontend_read(&pApp->frontend, &pApp->frontend_out, xTimeout))
+            adc_update(pApp);
+
+        if (xSemaphoreTake(pApp->semaphore_config, 0))
+        {
+            // Nueva configuracion, cambia la tasa del timer pero no el filtro.
+            frontend_start(&pApp->frontend, APP_ADC_CHANNEL, s__poll_period_us(pApp));
+            tstamp_jitter_reset(&pApp->jitter, s__poll_period_us(pApp));
+            s__restart_buffer(pApp);
+        }
+
+        if (xTaskGetTickCount() - xLastReport >= pdMS_TO_TICKS(APP_JITTER_REPORT_PERIOD))
+        {
+            s__report_jitter(&pApp->jitter);
+            s__report_overrun(pApp);
+            tstamp_jitter_reset(&pApp->jitter, pApp->jitter.nominal);
+            xLastReport = xTaskGetTickCount();
+        }
+    }
+}
+
+void vTaskADCDMA( void *pParam )
+{
+    app_type* pApp = pParam;
+    // Por si el DMA se detiene y no llega ninguna notificacion.
+    const TickType_t xTimeout = pdMS_TO_TICKS(10UL);
+    TickType_t xLastReport = xTaskGetTickCount();
+    tstamp_jitter jitter;
+
+    adc_init();
+    // Sin canal de DMA no se puede arrancar, se reintenta cada tanto.
+    while (s__adc_dma_setup(pApp) < 0)
+    {
+        messages_print("ERROR: no hay canal de DMA para el ADC\n\r");
+        vTaskDelay(pdMS_TO_TICKS(APP_ADC_DMA_RETRY_MS));
+    }
+
+    adc_dma_start(&pApp->adc_dma);
+    s__adc_dma_trigger(pApp);
+
+    while (1)
+    {
+        if (xSemaphoreTake(pApp->semaphore_config, 0))
+        {
+            // Nueva configuracion, en burst la tasa es fija.
+            if (APP_ADC_USES_TIMER)
+                s__adc_dma_trigger(pApp);
+        }
+
+        adc_dma_update(&pApp->adc_dma, xTimeout);
+
+        if (xTaskGetTickCount() - xLastReport >= pdMS_TO_TICKS(APP_JITTER_REPORT_PERIOD))
+        {
+            adc_dma_take_jitter(&pApp->adc_dma, &jitter);
+            s__report_jitter(&jitter);
+            xLastReport = xTaskGetTickCount();
+        }
+    }
+}
+
 void vTaskBluetooth( void *pParam )
 {
     app_type* pApp = pParam;
@@ -354,17 +1401,34 @@ void vTaskConfig( void *pParam )
     if (config_init(APP_SD_CONFIG_FILENAME, &pApp->config) < 0)
     {
         messages_print("ERROR: FATFS/SD, usando configuracion por defecto.\n\r");
-        pApp->config.sample_period = 0;
+        config_default(&pApp->config);
         pApp->config_sd_present = 0;
     }
+    else
+    {
+#if APP_CALIB_USED
+        s__load_calib(pApp);
+#endif
+#if APP_FILTER_USED
+        s__load_filter(pApp);
+#endif
+#if APP_PROC_MODE == APP_PROC_GOERTZEL
+        s__load_tones(pApp);
+#endif
+    }
     Board_LED_Set(LED_2, 0);
 
+    // Las tareas del ADC arrancaron con la config por defecto, avisamos que
+    // hay que tomar la que se leyo de la SD.
+    xSemaphoreGive(pApp->semaphore_config);
+
     messages_print("Sample period: ");
     char msg[2]; // Sabemos que el periodo nunca es >9 asi que entra en un char
     msg[0] = '0' + pApp->config.sample_period;
     msg[1] = '\0';
     messages_print(msg);
     messages_print("\n\r");
+    messages_print_int("Sample period [us]: ", pApp->config.sample_period_us, "\n\r");
     
     while (1)
     {
@@ -404,3 +1468,39 @@ void vTaskMPU( void *pParam )
         vTaskDelay(xTaskDelay);
     }
 }
+
+#if APP_SINK_UART
+void vTaskSinkUart( void *pParam )
+{
+    app_type* pApp = pParam;
+    static const char hex[] = "0123456789ABCDEF";
+    char line[2 * APP_DATA_BUF_SIZE + 3];
+    TickType_t xLastReport = xTaskGetTickCount();
+
+    while (1)
+    {
+        uint8_t* buf = buffer_queue_get_inuse_by(&pApp->data_queue, pApp->sink_uart,
+                                                 pdMS_TO_TICKS(APP_JITTER_REPORT_PERIOD));
+        if (buf != NULL)
+        {
+            const unsigned n = buffer_queue_len(&pApp->data_queue, buf);
+            for (unsigned i = 0; i < n; ++i)
+            {
+                line[2*i + 0] = hex[buf[i] >> 4];
+                line[2*i + 1] = hex[buf[i] & 0x0F];
+            }
+            buffer_queue_return(&pApp->data_queue, buf);
+            line[2*n + 0] = '\n';
+            line[2*n + 1] = '\r';
+            line[2*n + 2] = '\0';
+            messages_print(line);
+        }
+
+        if (xTaskGetTickCount() - xLastReport >= pdMS_TO_TICKS(APP_JITTER_REPORT_PERIOD))
+        {
+            s__report_consumers(pApp);
+            xLastReport = xTaskGetTickCount();
+        }
+    }
+}
+#endif
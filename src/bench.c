@@ -0,0 +1,206 @@
+#include "bench.h"
+#include "codec.h"
+#include "scale.h"
+#include "goertzel.h"
+#include "spectrum.h"
+#include "index_ring.h"
+#include <queue.h>
+#include "messages.h"
+#include <chip.h>
+#include <math.h>
+
+
+/// Bloque maximo de los benchmarks.
+#define BENCH_MAX_BLOCK     256
+
+
+static uint8_t s__in[BENCH_MAX_BLOCK];
+static uint8_t s__out[CODEC_MAX_SIZE(BENCH_MAX_BLOCK)];
+static uint8_t s__dec[BENCH_MAX_BLOCK];
+static goertzel_type s__goertzel;
+#if SPECTRUM_USED
+static spectrum_type s__spectrum;
+#endif
+
+
+void bench_init( void )
+{
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL  |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+uint32_t bench_cycles( void )
+{
+    return DWT->CYCCNT;
+}
+
+void bench_signal( unsigned signal, uint8_t* out, unsigned n )
+{
+    uint32_t seed = 12345;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        seed = seed * 1103515245UL + 12345;
+        const int noise = (seed >> 16) % 3 - 1;
+
+        switch (signal)
+        {
+        case BENCH_SIGNAL_SLOW:
+            out[i] = 128 + 20.0f * sinf(2.0f * 3.14159265f * i / 200.0f) + noise;
+            break;
+        case BENCH_SIGNAL_RAMP:
+            out[i] = i / 3;
+            break;
+        case BENCH_SIGNAL_STEP:
+            out[i] = ((i / 32) & 1) ? 200 : 50;
+            break;
+        default: // BENCH_SIGNAL_NOISE
+            out[i] = seed >> 24;
+            break;
+        }
+    }
+}
+
+void bench_codec( unsigned block )
+{
+    static const char* const signals[BENCH_N_SIGNALS] = { "lenta", "rampa", "escalon", "ruido" };
+    static const char* const codecs[] = { "raw", "rice", "adpcm" };
+
+    if (block > BENCH_MAX_BLOCK)
+        block = BENCH_MAX_BLOCK;
+
+    for (unsigned s = 0; s < BENCH_N_SIGNALS; ++s)
+    {
+        bench_signal(s, s__in, block);
+        messages_print("Bench codec, senal ");
+        messages_print(signals[s]);
+        messages_print("\n\r");
+
+        for (uint8_t c = CODEC_RAW; c <= CODEC_ADPCM; ++c)
+        {
+            uint32_t t0 = bench_cycles();
+            unsigned len = codec_encode(c, s__in, block, s__out);
+            uint32_t t1 = bench_cycles();
+            int n = codec_decode(s__out, len, s__dec, block);
+            uint32_t t2 = bench_cycles();
+
+            int err = (n == (int) block) ? 0 : 255;
+            for (unsigned i = 0; i < block && n == (int) block; ++i)
+            {
+                int e = (s__dec[i] > s__in[i]) ? s__dec[i] - s__in[i] : s__in[i] - s__dec[i];
+                if (e > err)
+                    err = e;
+            }
+
+            messages_print("  ");
+            messages_print(codecs[c]);
+            messages_print_int(": relacion x100 ", 100UL * block / len, "");
+            messages_print_int(", ciclos/muestra cod ", (t1 - t0) / block, "");
+            messages_print_int(" dec ", (t2 - t1) / block, "");
+            messages_print_int(", error max ", err, "\n\r");
+        }
+    }
+}
+
+void bench_scale( unsigned n )
+{
+    // Ganancia tipica del acelerometro, 'volatile' para que no se resuelva al
+    // compilar.
+    volatile float mult = 1.7f;
+
+    if (n > BENCH_MAX_BLOCK)
+        n = BENCH_MAX_BLOCK;
+    bench_signal(BENCH_SIGNAL_SLOW, s__in, n);
+
+    uint32_t t0 = bench_cycles();
+    const float m = mult;
+    for (unsigned i = 0; i < n; ++i)
+        s__dec[i] = s__in[i] * m;
+    uint32_t t1 = bench_cycles();
+    scale_apply(s__in, s__dec, n, scale_gain_from_float(mult));
+    uint32_t t2 = bench_cycles();
+
+    messages_print_int("Bench escalado, muestras: ", n, "\n\r");
+    messages_print_int("  float, ciclos: ", t1 - t0, "\n\r");
+    messages_print_int("  scale_apply, ciclos: ", t2 - t1, "\n\r");
+}
+
+void bench_goertzel( unsigned size, unsigned n_tones )
+{
+    if (size > BENCH_MAX_BLOCK)
+        size = BENCH_MAX_BLOCK;
+    if (n_tones > GOERTZEL_TONES_MAX)
+        n_tones = GOERTZEL_TONES_MAX;
+    if (goertzel_init(&s__goertzel, size) < 0)
+    {
+        messages_print("ERROR: tamano del bench de Goertzel\n\r");
+        return;
+    }
+#if SPECTRUM_USED
+    if (spectrum_init(&s__spectrum, size, 1) < 0)
+    {
+        messages_print("ERROR: tamano del bench de Goertzel\n\r");
+        return;
+    }
+#endif
+    bench_signal(BENCH_SIGNAL_NOISE, s__in, size);
+
+    // Tonos cualquiera, el costo no depende de la frecuencia.
+    static goertzel_tones tones;
+    tones.n = n_tones;
+    for (unsigned t = 0; t < n_tones; ++t)
+        tones.freq_mhz[t] = (t + 1) * 50000UL;
+    goertzel_set_tones(&s__goertzel, &tones, 1000);
+
+    static uint16_t amps[GOERTZEL_TONES_MAX];
+    bool done;
+
+    uint32_t t0 = bench_cycles();
+    goertzel_push(&s__goertzel, s__in, size, amps, &done);
+    uint32_t t1 = bench_cycles();
+
+    messages_print_int("Bench Goertzel, muestras: ", size, "");
+    messages_print_int(", tonos: ", n_tones, "\n\r");
+    messages_print_int("  Goertzel, ciclos: ", t1 - t0, "\n\r");
+#if SPECTRUM_USED
+    // Se vuelve a tomar el tiempo, los mensajes de arriba no cuentan.
+    static uint16_t bins[SPECTRUM_MAX_SIZE / 2];
+    uint32_t t2 = bench_cycles();
+    for (unsigned i = 0; i < size; ++i)
+        if (spectrum_push(&s__spectrum, s__in[i]))
+            spectrum_bins(&s__spectrum, bins);
+    uint32_t t3 = bench_cycles();
+    messages_print_int("  FFT, ciclos: ", t3 - t2, "\n\r");
+#endif
+}
+
+void bench_buffer_queue( unsigned n )
+{
+    static index_ring ring;
+    static StaticQueue_t queue_buf;
+    static uint8_t queue_mem[INDEX_RING_MAX * sizeof(uint8_t*)];
+    QueueHandle_t queue = xQueueCreateStatic(INDEX_RING_MAX, sizeof(uint8_t*), queue_mem, &queue_buf);
+    index_ring_init(&ring, INDEX_RING_MAX);
+
+    // Mismo patron que buffer_queue: se saca uno, se pone en la otra lista.
+    uint8_t* p = s__in;
+    uint32_t t0 = bench_cycles();
+    for (unsigned i = 0; i < n; ++i)
+    {
+        index_ring_push(&ring, i & 0x0F);
+        index_ring_pop(&ring, 0);
+    }
+    uint32_t t1 = bench_cycles();
+    for (unsigned i = 0; i < n; ++i)
+    {
+        xQueueSendToBack(queue, &p, 0);
+        xQueueReceive(queue, &p, 0);
+    }
+    uint32_t t2 = bench_cycles();
+
+    // Dos operaciones por vuelta.
+    const uint64_t ops = 2ULL * n * SystemCoreClock;
+    messages_print_int("Bench buffer_queue, operaciones: ", 2 * n, "\n\r");
+    messages_print_int("  anillo, ops/s: ", ops / (t1 - t0), "\n\r");
+    messages_print_int("  cola, ops/s: ", ops / (t2 - t1), "\n\r");
+}
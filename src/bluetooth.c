@@ -16,6 +16,12 @@ void bluetooth_write( uint8_t data )
     uart_write(UART_232, data);
 }
 
+void bluetooth_write_buf( const uint8_t* data, unsigned n )
+{
+    for (unsigned i = 0; i < n; ++i)
+        uart_write(UART_232, data[i]);
+}
+
 bool bluetooth_read( uint8_t* data )
 {
     return uart_read(UART_232, data);
@@ -1,48 +1,295 @@
 #include "buffer_queue.h"
+#include <task.h>
 
 
-uint8_t* s__get_buffer( QueueHandle_t handle, TickType_t xTicksToWait )
+/*
+ * Las listas guardan indices de buffer.  Cada implementacion da las mismas
+ * operaciones sobre la lista 'avail' y las 'inuse' de cada consumidor, el
+ * resto es comun.  Con 'pxWoken' en NULL se llaman desde una tarea, si no
+ * desde una interrupcion y ahi se acumula si hay que cambiar de tarea.
+ */
+#if BUFFER_QUEUE_RING
+
+static int s__list_init( buffer_queue_list* l, unsigned n )
+{
+    return index_ring_init(l, n);
+}
+
+static void s__list_put( buffer_queue_list* l, unsigned idx, BaseType_t* pxWoken )
+{
+    if (pxWoken == NULL)
+        index_ring_push(l, idx);
+    else
+        index_ring_push_from_isr(l, idx, pxWoken);
+}
+
+static int s__list_get( buffer_queue_list* l, TickType_t xTicksToWait, BaseType_t* pxWoken )
+{
+    // Sin espera no pasa por el scheduler, sirve igual desde la interrupcion.
+    return index_ring_pop(l, (pxWoken == NULL) ? xTicksToWait : 0);
+}
+
+static unsigned s__list_count( const buffer_queue_list* l, BaseType_t* pxWoken )
+{
+    (void) pxWoken;
+    return index_ring_count(l);
+}
+
+#else
+
+static int s__list_init( buffer_queue_list* l, unsigned n )
 {
-    uint8_t* ret;
-    BaseType_t xSts = xQueueReceive(handle, &ret, xTicksToWait);
-    return (xSts == pdPASS) ? ret : NULL;
+    l->handle = xQueueCreateStatic(n, sizeof(uint8_t), l->mem, &l->queue);
+    return (l->handle != NULL) ? 0 : -1;
+}
+
+static void s__list_put( buffer_queue_list* l, unsigned idx, BaseType_t* pxWoken )
+{
+    const uint8_t i = idx;
+    if (pxWoken == NULL)
+        xQueueSendToBack(l->handle, &i, 0);
+    else
+        xQueueSendToBackFromISR(l->handle, &i, pxWoken);
+}
+
+static int s__list_get( buffer_queue_list* l, TickType_t xTicksToWait, BaseType_t* pxWoken )
+{
+    uint8_t i;
+    BaseType_t xSts;
+    if (pxWoken == NULL)
+        xSts = xQueueReceive(l->handle, &i, xTicksToWait);
+    else
+        xSts = xQueueReceiveFromISR(l->handle, &i, pxWoken);
+    return (xSts == pdPASS) ? i : -1;
+}
+
+static unsigned s__list_count( const buffer_queue_list* l, BaseType_t* pxWoken )
+{
+    if (pxWoken == NULL)
+        return uxQueueMessagesWaiting(l->handle);
+    return uxQueueMessagesWaitingFromISR(l->handle);
+}
+
+#endif
+
+
+static uint8_t* s__buffer( const buffer_queue* bq, int idx )
+{
+    return (idx >= 0) ? bq->mem + (unsigned) idx * bq->size : NULL;
+}
+
+static TickType_t s__now( BaseType_t* pxWoken )
+{
+    return (pxWoken == NULL) ? xTaskGetTickCount() : xTaskGetTickCountFromISR();
+}
+
+static void s__push( buffer_queue* bq, uint8_t* buf, unsigned len, BaseType_t* pxWoken )
+{
+    int idx = buffer_queue_index(bq, buf);
+    if (idx < 0)
+        return;
+
+    // Todo se escribe antes de publicarlo en la primer lista.
+    bq->len[idx]    = len;
+    bq->pushed[idx] = s__now(pxWoken);
+    bq->refs[idx]   = bq->n_consumers;
+    for (unsigned c = 0; c < bq->n_consumers; ++c)
+        s__list_put(&bq->inuse[c], idx, pxWoken);
+}
+
+static uint8_t* s__get_inuse( buffer_queue* bq, unsigned consumer, TickType_t xTicksToWait, BaseType_t* pxWoken )
+{
+    int idx = s__list_get(&bq->inuse[consumer], xTicksToWait, pxWoken);
+    if (idx < 0)
+        return NULL;
+
+    // Los que quedan esperando mas este.
+    buffer_queue_stats* st = &bq->stats[consumer];
+    const uint32_t lag = s__list_count(&bq->inuse[consumer], pxWoken) + 1;
+    const uint32_t age = s__now(pxWoken) - bq->pushed[idx];
+    st->taken++;
+    st->age_sum += age;
+    if (lag > st->lag_max)
+        st->lag_max = lag;
+    if (age > st->age_max)
+        st->age_max = age;
+    return s__buffer(bq, idx);
+}
+
+static void s__return( buffer_queue* bq, uint8_t* buf, BaseType_t* pxWoken )
+{
+    int idx = buffer_queue_index(bq, buf);
+    if (idx < 0)
+        return;
+
+    // Uno que nunca se entrego vuelve directo, uno entregado cuando lo libera
+    // el ultimo consumidor.
+    if (bq->refs[idx] == 0 || __atomic_sub_fetch(&bq->refs[idx], 1, __ATOMIC_ACQ_REL) == 0)
+        s__list_put(&bq->avail, idx, pxWoken);
+}
+
+static bool s__drop_oldest( buffer_queue* bq, BaseType_t* pxWoken )
+{
+    // Sin estadisticas: las escribe solo el consumidor, y esto no es sacar.
+    int idx = s__list_get(&bq->inuse[0], 0, pxWoken);
+    if (idx < 0)
+        return false;
+
+    s__return(bq, s__buffer(bq, idx), pxWoken);
+    return true;
 }
 
 
 int buffer_queue_init( buffer_queue* bq, uint8_t* mem, unsigned size, unsigned n )
 {
-    bq->avail    = xQueueCreate(n, sizeof(mem));
-    bq->inuse    = xQueueCreate(n, sizeof(mem));
-    bq->mem      = mem;
-    bq->size     = size;
-    bq->n_elems  = n;
+    bq->mem         = mem;
+    bq->size        = size;
+    bq->n_elems     = n;
+    bq->n_consumers = 0;
 
-    BaseType_t xSts = pdPASS;
-    for (unsigned i = 0; i < n && xSts == pdPASS; ++i)
+    if (n > BUFFER_QUEUE_MAX)
+        return -1;
+    for (unsigned i = 0; i < n; ++i)
     {
-        xSts = xQueueSendToBack(bq->avail, &mem, 0);
-        mem += size;
+        bq->len[i]  = size;
+        bq->meta[i] = 0;
+        bq->refs[i] = 0;
     }
 
-    return (xSts == pdPASS) ? 0 : -1;
+    // El consumidor 0 es el de buffer_queue_get_inuse.
+    if (s__list_init(&bq->avail, n) < 0 || buffer_queue_add_consumer(bq) < 0)
+        return -1;
+    for (unsigned i = 0; i < n; ++i)
+        s__list_put(&bq->avail, i, NULL);
+    return 0;
+}
+
+int buffer_queue_add_consumer( buffer_queue* bq )
+{
+    const unsigned c = bq->n_consumers;
+    if (c >= BUFFER_QUEUE_CONSUMERS_MAX || s__list_init(&bq->inuse[c], bq->n_elems) < 0)
+        return -1;
+
+    bq->stats[c].taken   = 0;
+    bq->stats[c].lag_max = 0;
+    bq->stats[c].age_max = 0;
+    bq->stats[c].age_sum = 0;
+    bq->n_consumers = c + 1;
+    return c;
 }
 
 uint8_t* buffer_queue_get_avail( buffer_queue* bq, TickType_t xTicksToWait )
 {
-    return s__get_buffer(bq->avail, xTicksToWait);
+    return s__buffer(bq, s__list_get(&bq->avail, xTicksToWait, NULL));
 }
 
 void buffer_queue_push( buffer_queue* bq, uint8_t* buf )
 {
-    xQueueSendToBack(bq->inuse, &buf, 0);
+    s__push(bq, buf, bq->size, NULL);
+}
+
+void buffer_queue_push_partial( buffer_queue* bq, uint8_t* buf, unsigned len )
+{
+    s__push(bq, buf, len, NULL);
 }
 
 uint8_t* buffer_queue_get_inuse( buffer_queue* bq, TickType_t xTicksToWait )
 {
-    return s__get_buffer(bq->inuse, xTicksToWait);
+    return s__get_inuse(bq, 0, xTicksToWait, NULL);
+}
+
+uint8_t* buffer_queue_get_inuse_by( buffer_queue* bq, unsigned consumer, TickType_t xTicksToWait )
+{
+    return s__get_inuse(bq, consumer, xTicksToWait, NULL);
 }
 
 void buffer_queue_return( buffer_queue* bq, uint8_t* buf )
 {
-    xQueueSendToBack(bq->avail, &buf, 0);
+    s__return(bq, buf, NULL);
+}
+
+bool buffer_queue_drop_oldest( buffer_queue* bq )
+{
+    return s__drop_oldest(bq, NULL);
+}
+
+uint8_t* buffer_queue_get_avail_from_isr( buffer_queue* bq, BaseType_t* pxHigherPriorityTaskWoken )
+{
+    return s__buffer(bq, s__list_get(&bq->avail, 0, pxHigherPriorityTaskWoken));
+}
+
+void buffer_queue_push_from_isr( buffer_queue* bq, uint8_t* buf, BaseType_t* pxHigherPriorityTaskWoken )
+{
+    s__push(bq, buf, bq->size, pxHigherPriorityTaskWoken);
+}
+
+void buffer_queue_push_partial_from_isr( buffer_queue* bq, uint8_t* buf, unsigned len, BaseType_t* pxHigherPriorityTaskWoken )
+{
+    s__push(bq, buf, len, pxHigherPriorityTaskWoken);
+}
+
+uint8_t* buffer_queue_get_inuse_from_isr( buffer_queue* bq, BaseType_t* pxHigherPriorityTaskWoken )
+{
+    return s__get_inuse(bq, 0, 0, pxHigherPriorityTaskWoken);
+}
+
+uint8_t* buffer_queue_get_inuse_by_from_isr( buffer_queue* bq, unsigned consumer, BaseType_t* pxHigherPriorityTaskWoken )
+{
+    return s__get_inuse(bq, consumer, 0, pxHigherPriorityTaskWoken);
+}
+
+void buffer_queue_return_from_isr( buffer_queue* bq, uint8_t* buf, BaseType_t* pxHigherPriorityTaskWoken )
+{
+    s__return(bq, buf, pxHigherPriorityTaskWoken);
+}
+
+bool buffer_queue_drop_oldest_from_isr( buffer_queue* bq, BaseType_t* pxHigherPriorityTaskWoken )
+{
+    return s__drop_oldest(bq, pxHigherPriorityTaskWoken);
+}
+
+unsigned buffer_queue_avail_count( const buffer_queue* bq )
+{
+    return s__list_count(&bq->avail, NULL);
+}
+
+unsigned buffer_queue_inuse_count( const buffer_queue* bq )
+{
+    return buffer_queue_inuse_count_by(bq, 0);
+}
+
+unsigned buffer_queue_inuse_count_by( const buffer_queue* bq, unsigned consumer )
+{
+    return s__list_count(&bq->inuse[consumer], NULL);
+}
+
+void buffer_queue_get_stats( const buffer_queue* bq, unsigned consumer, buffer_queue_stats* out )
+{
+    *out = bq->stats[consumer];
+}
+
+unsigned buffer_queue_len( const buffer_queue* bq, const uint8_t* buf )
+{
+    int idx = buffer_queue_index(bq, buf);
+    return (idx >= 0) ? bq->len[idx] : 0;
+}
+
+void buffer_queue_set_meta( buffer_queue* bq, const uint8_t* buf, uint32_t meta )
+{
+    int idx = buffer_queue_index(bq, buf);
+    if (idx >= 0)
+        bq->meta[idx] = meta;
+}
+
+uint32_t buffer_queue_get_meta( const buffer_queue* bq, const uint8_t* buf )
+{
+    int idx = buffer_queue_index(bq, buf);
+    return (idx >= 0) ? bq->meta[idx] : 0;
+}
+
+int buffer_queue_index( const buffer_queue* bq, const uint8_t* buf )
+{
+    if (buf < bq->mem || buf >= bq->mem + bq->size * bq->n_elems)
+        return -1;
+    return (buf - bq->mem) / bq->size;
 }
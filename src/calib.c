@@ -0,0 +1,119 @@
+#include "calib.h"
+#include <string.h>
+#include <stdbool.h>
+
+
+void calib_default( calib_channel* ch )
+{
+    for (unsigned i = 0; i < CALIB_N_CHANNELS; ++i)
+    {
+        ch[i].offset   = 0;
+        ch[i].gain     = CALIB_GAIN_ONE;
+        ch[i].n_points = 0;
+    }
+}
+
+int calib_parse( calib_channel* ch, const uint8_t* data, unsigned n )
+{
+    int loaded = 0;
+    unsigned pos = 0;
+
+    calib_default(ch);
+    while (pos < n)
+    {
+        if (n - pos < 6)
+            break;
+        const uint8_t chn = data[pos];
+        const uint8_t np  = data[pos + 1];
+        if (chn >= CALIB_N_CHANNELS || np == 1 || np > CALIB_POINTS_MAX || n - pos < 6U + 2 * np)
+            break;
+
+        calib_channel* c = &ch[chn];
+        bool sorted = true;
+        c->offset   = (int16_t)(data[pos + 2] | (data[pos + 3] << 8));
+        c->gain     = data[pos + 4] | (data[pos + 5] << 8);
+        c->n_points = np;
+        for (unsigned i = 0; i < np; ++i)
+        {
+            c->px[i] = data[pos + 6 + 2*i];
+            c->py[i] = data[pos + 7 + 2*i];
+            if (i > 0 && c->px[i] <= c->px[i-1])
+                sorted = false;
+        }
+        if (!sorted)
+            break;
+
+        pos += 6 + 2 * np;
+        loaded++;
+    }
+
+    if (pos != n)
+    {
+        calib_default(ch);
+        return -1;
+    }
+    return loaded;
+}
+
+uint8_t calib_eval( const calib_channel* c, uint8_t x )
+{
+    // En Q8.8 todo el calculo.  El producto por la ganancia no entra en 32
+    // bits con ganancias grandes; esto solo arma la tabla, no importa el costo.
+    int32_t v = (int32_t) (((((int64_t) x << 8) + c->offset) * c->gain) >> 12);
+
+    if (c->n_points >= 2)
+    {
+        unsigned j = 0;
+        while (j + 2 < c->n_points && v >= ((int32_t) c->px[j + 1] << 8))
+            j++;
+        const int32_t x0 = (int32_t) c->px[j] << 8;
+        const int32_t y0 = (int32_t) c->py[j] << 8;
+        const int32_t dx = c->px[j + 1] - c->px[j];
+        const int32_t dy = c->py[j + 1] - c->py[j];
+        v = y0 + (v - x0) * dy / dx;
+    }
+
+    v = (v + 128) >> 8;
+    return (v < 0) ? 0 : (v > 255) ? 255 : v;
+}
+
+void calib_build( calib_type* cal, const calib_channel* ch )
+{
+    for (unsigned c = 0; c < CALIB_N_CHANNELS; ++c)
+        for (unsigned x = 0; x < 256; ++x)
+            cal->lut[c][x] = calib_eval(&ch[c], x);
+}
+
+void calib_apply( const calib_type* cal, unsigned chn, uint8_t* buf, unsigned n )
+{
+    const uint8_t* lut = cal->lut[chn];
+    unsigned i = 0;
+
+    // Una lectura y una escritura de palabra cada 4 muestras.
+    for (; i + 4 <= n; i += 4)
+    {
+        uint32_t x;
+        memcpy(&x, &buf[i], sizeof(x));
+        x = (uint32_t) lut[x & 0xFF]
+          | (uint32_t) lut[(x >> 8) & 0xFF] << 8
+          | (uint32_t) lut[(x >> 16) & 0xFF] << 16
+          | (uint32_t) lut[x >> 24] << 24;
+        memcpy(&buf[i], &x, sizeof(x));
+    }
+    for (; i < n; ++i)
+        buf[i] = lut[buf[i]];
+}
+
+void calib_apply_scan( const calib_type* cal, uint8_t mask, uint8_t* buf, unsigned n )
+{
+    uint8_t chns[CALIB_N_CHANNELS];
+    unsigned n_chn = 0;
+    for (unsigned c = 0; c < CALIB_N_CHANNELS; ++c)
+        if (mask & (1 << c))
+            chns[n_chn++] = c;
+    if (n_chn == 0)
+        return;
+
+    for (unsigned i = 0; i < n; ++i)
+        buf[i] = cal->lut[chns[i % n_chn]][buf[i]];
+}
@@ -0,0 +1,141 @@
+#include "capture.h"
+#include "adc.h"
+#include "tstamp.h"
+
+
+/// Instancia que atiende la interrupcion del ADC.
+static capture_type* s__capture = NULL;
+
+
+static bool s__on_sample( uint16_t sample )
+{
+    capture_type* cap = s__capture;
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    // El ADC esta en 8 bits, los 2 bits bajos del resultado no valen.
+    if (cap != NULL && capture_push(cap, sample >> 2, tstamp_now()))
+        vTaskNotifyGiveFromISR(cap->task, &xHigherPriorityTaskWoken);
+
+    return xHigherPriorityTaskWoken == pdTRUE;
+}
+
+static bool s__is_trigger( const capture_type* cap, uint8_t prev, uint8_t sample )
+{
+    const bool rising  = prev <  cap->level && sample >= cap->level;
+    const bool falling = prev >= cap->level && sample <  cap->level;
+    const unsigned jump = (sample > prev) ? sample - prev : prev - sample;
+
+    if (jump < cap->slope_min)
+        return false;
+    if (cap->edge == CAPTURE_RISING)
+        return rising;
+    if (cap->edge == CAPTURE_FALLING)
+        return falling;
+    return rising || falling;
+}
+
+static void s__reverse( uint8_t* p, unsigned n )
+{
+    for (unsigned i = 0; i < n / 2; ++i)
+    {
+        uint8_t t    = p[i];
+        p[i]         = p[n - 1 - i];
+        p[n - 1 - i] = t;
+    }
+}
+
+
+int capture_init( capture_type* cap, uint8_t* mem, unsigned mem_size,
+                  unsigned pre, unsigned post )
+{
+    if (post == 0 || pre + post > mem_size)
+        return -1;
+
+    cap->mem  = mem;
+    cap->pre  = pre;
+    cap->post = post;
+    cap->task = NULL;
+    cap->triggers = 0;
+    capture_set_trigger(cap, 128, CAPTURE_RISING, 0);
+    capture_rearm(cap);
+    return 0;
+}
+
+void capture_set_trigger( capture_type* cap, uint8_t level, uint8_t edge, uint8_t slope_min )
+{
+    cap->level     = level;
+    cap->edge      = edge;
+    cap->slope_min = slope_min;
+}
+
+bool capture_push( capture_type* cap, uint8_t sample, uint32_t now )
+{
+    if (cap->state == CAPTURE_DONE)
+        return false;
+
+    const unsigned n = cap->pre + cap->post;
+    const uint8_t prev = cap->prev;
+    cap->mem[cap->idx] = sample;
+    cap->idx  = (cap->idx + 1 < n) ? cap->idx + 1 : 0;
+    cap->prev = sample;
+
+    if (cap->state == CAPTURE_ARMED)
+    {
+        // Recien con la historia completa (y una muestra anterior para ver el
+        // cruce) se puede disparar.
+        if (cap->filled <= cap->pre)
+        {
+            cap->filled++;
+            return false;
+        }
+        if (!s__is_trigger(cap, prev, sample))
+            return false;
+
+        cap->trig_tstamp = now;
+        cap->remaining   = cap->post;
+        cap->state       = CAPTURE_POST;
+    }
+
+    if (--cap->remaining > 0)
+        return false;
+
+    cap->state = CAPTURE_DONE;
+    cap->triggers++;
+    return true;
+}
+
+void capture_start( capture_type* cap, int chn, uint32_t period_us )
+{
+    cap->task  = xTaskGetCurrentTaskHandle();
+    s__capture = cap;
+
+    adc_irq_start(chn, s__on_sample);
+    adc_timer_start(chn, period_us);
+}
+
+uint8_t* capture_wait( capture_type* cap, TickType_t xTicksToWait )
+{
+    ulTaskNotifyTake(pdTRUE, xTicksToWait);
+    if (cap->state != CAPTURE_DONE)
+        return NULL;
+
+    // La mas vieja esta en 'idx', rotamos para que quede primera.  Con la
+    // captura detenida la interrupcion no toca la memoria.
+    const unsigned n = cap->pre + cap->post;
+    s__reverse(cap->mem, cap->idx);
+    s__reverse(cap->mem + cap->idx, n - cap->idx);
+    s__reverse(cap->mem, n);
+    cap->idx = 0;
+    return cap->mem;
+}
+
+void capture_rearm( capture_type* cap )
+{
+    taskENTER_CRITICAL();
+    cap->idx       = 0;
+    cap->filled    = 0;
+    cap->remaining = 0;
+    cap->prev      = 0;
+    cap->state     = CAPTURE_ARMED;
+    taskEXIT_CRITICAL();
+}
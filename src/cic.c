@@ -0,0 +1,51 @@
+#include "cic.h"
+
+
+int cic_init( cic_type* cic, unsigned order, unsigned log2_ratio,
+              unsigned in_bits, unsigned out_bits )
+{
+    const unsigned growth = in_bits + order*log2_ratio;
+    if (order < 1 || order > CIC_MAX_ORDER || growth > 32 || out_bits > growth)
+        return -1;
+
+    cic->order      = order;
+    cic->log2_ratio = log2_ratio;
+    cic->shift      = growth - out_bits;
+    cic->out_max    = (1UL << out_bits) - 1;
+    cic->phase      = 0;
+    for (unsigned i = 0; i < CIC_MAX_ORDER; ++i)
+    {
+        cic->integ[i] = 0;
+        cic->comb[i]  = 0;
+    }
+    return 0;
+}
+
+bool cic_push( cic_type* cic, uint16_t in, uint16_t* out )
+{
+    // Integradores, a la tasa de entrada.
+    uint32_t acc = in;
+    for (unsigned i = 0; i < cic->order; ++i)
+    {
+        cic->integ[i] += acc;
+        acc = cic->integ[i];
+    }
+
+    if (++cic->phase < (1U << cic->log2_ratio))
+        return false;
+    cic->phase = 0;
+
+    // Peines, a la tasa de salida.
+    for (unsigned i = 0; i < cic->order; ++i)
+    {
+        uint32_t prev = cic->comb[i];
+        cic->comb[i] = acc;
+        acc -= prev;
+    }
+
+    // Redondeo y saturacion, por el transitorio del arranque.
+    if (cic->shift > 0)
+        acc = (acc >> cic->shift) + ((acc >> (cic->shift - 1)) & 1);
+    *out = (acc > cic->out_max) ? cic->out_max : acc;
+    return true;
+}
@@ -0,0 +1,281 @@
+#include "codec.h"
+#include <string.h>
+
+
+/// Cocientes de Rice a partir del cual se escapa a la muestra cruda.
+#define RICE_ESCAPE     8
+/// k maximo de Rice.
+#define RICE_K_MAX      7
+
+
+typedef struct _bit_writer
+{
+    uint8_t*    out;
+    unsigned    len;
+    uint32_t    acc;
+    unsigned    n_bits;
+}
+bit_writer;
+
+typedef struct _bit_reader
+{
+    const uint8_t* in;
+    unsigned    len;
+    unsigned    pos;
+    uint32_t    acc;
+    unsigned    n_bits;
+}
+bit_reader;
+
+
+/// Tabla de pasos de IMA ADPCM, para muestras de 16 bits.
+static const int16_t s__adpcm_step[89] =
+{
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41,
+    45, 50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209,
+    230, 253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876,
+    963, 1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749,
+    3024, 3327, 3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630,
+    9493, 10442, 11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623,
+    27086, 29794, 32767
+};
+
+static const int8_t s__adpcm_index[8] = { -1, -1, -1, -1, 2, 4, 6, 8 };
+
+/// Indice inicial de ADPCM: el paso de una cuenta de 8 bits (256).
+#define ADPCM_INDEX0    38
+
+
+static void s__put_bits( bit_writer* bw, uint32_t bits, unsigned n )
+{
+    bw->acc     = (bw->acc << n) | bits;
+    bw->n_bits += n;
+    while (bw->n_bits >= 8)
+    {
+        bw->n_bits -= 8;
+        bw->out[bw->len++] = bw->acc >> bw->n_bits;
+    }
+}
+
+static void s__flush_bits( bit_writer* bw )
+{
+    if (bw->n_bits > 0)
+        bw->out[bw->len++] = bw->acc << (8 - bw->n_bits);
+    bw->n_bits = 0;
+}
+
+static int s__get_bits( bit_reader* br, unsigned n )
+{
+    while (br->n_bits < n)
+    {
+        if (br->pos >= br->len)
+            return -1;
+        br->acc     = (br->acc << 8) | br->in[br->pos++];
+        br->n_bits += 8;
+    }
+    br->n_bits -= n;
+    return (br->acc >> br->n_bits) & ((1UL << n) - 1);
+}
+
+static uint8_t s__zigzag( uint8_t x, uint8_t prev )
+{
+    int8_t d = (uint8_t)(x - prev);
+    return (d >= 0) ? 2 * d : -2 * d - 1;
+}
+
+static uint8_t s__unzigzag( unsigned u, uint8_t prev )
+{
+    int d = (u & 1) ? -(int)((u + 1) / 2) : (int)(u / 2);
+    return prev + d;
+}
+
+static unsigned s__rice_bits( unsigned u, unsigned k )
+{
+    unsigned q = u >> k;
+    return (q < RICE_ESCAPE) ? q + 1 + k : RICE_ESCAPE + 8;
+}
+
+static void s__adpcm_step_update( int* pred, int* index, unsigned code )
+{
+    const int step = s__adpcm_step[*index];
+    int vpdiff = step >> 3;
+    if (code & 4) vpdiff += step;
+    if (code & 2) vpdiff += step >> 1;
+    if (code & 1) vpdiff += step >> 2;
+
+    *pred += (code & 8) ? -vpdiff : vpdiff;
+    if (*pred >  32767) *pred =  32767;
+    if (*pred < -32768) *pred = -32768;
+
+    *index += s__adpcm_index[code & 7];
+    if (*index < 0)  *index = 0;
+    if (*index > 88) *index = 88;
+}
+
+static uint8_t s__adpcm_sample( int pred )
+{
+    int x = ((pred + 128) >> 8) + 128;
+    return (x < 0) ? 0 : (x > 255) ? 255 : x;
+}
+
+
+unsigned codec_encode( uint8_t codec, const uint8_t* in, unsigned n, uint8_t* out )
+{
+    bit_writer bw = { out + CODEC_HDR_SIZE, 0, 0, 0 };
+    uint8_t param = 0;
+
+    if (codec == CODEC_RICE)
+    {
+        // El k que da menos bits en este bloque.
+        unsigned best = ~0U;
+        for (unsigned k = 0; k <= RICE_K_MAX; ++k)
+        {
+            unsigned bits = 0;
+            for (unsigned i = 1; i < n; ++i)
+                bits += s__rice_bits(s__zigzag(in[i], in[i-1]), k);
+            if (bits < best)
+            {
+                best  = bits;
+                param = k;
+            }
+        }
+
+        for (unsigned i = 1; i < n; ++i)
+        {
+            unsigned u = s__zigzag(in[i], in[i-1]);
+            unsigned q = u >> param;
+            if (q < RICE_ESCAPE)
+            {
+                // q unos, un cero y los k bits bajos.
+                s__put_bits(&bw, ((1UL << q) - 1) << 1, q + 1);
+                s__put_bits(&bw, u & ((1UL << param) - 1), param);
+            }
+            else
+            {
+                s__put_bits(&bw, (1UL << RICE_ESCAPE) - 1, RICE_ESCAPE);
+                s__put_bits(&bw, u, 8);
+            }
+        }
+        s__flush_bits(&bw);
+    }
+    else if (codec == CODEC_ADPCM)
+    {
+        int pred  = (in[0] - 128) << 8;
+        int index = ADPCM_INDEX0;
+        param = index;
+        for (unsigned i = 1; i < n; ++i)
+        {
+            int diff = ((in[i] - 128) << 8) - pred;
+            unsigned code = 0;
+            if (diff < 0)
+            {
+                code = 8;
+                diff = -diff;
+            }
+            int step = s__adpcm_step[index];
+            if (diff >= step) { code |= 4; diff -= step; }
+            step >>= 1;
+            if (diff >= step) { code |= 2; diff -= step; }
+            step >>= 1;
+            if (diff >= step) { code |= 1; }
+
+            s__adpcm_step_update(&pred, &index, code);
+            s__put_bits(&bw, code, 4);
+        }
+        s__flush_bits(&bw);
+    }
+
+    // Si no comprime (o el codec no existe) van crudas.
+    if (codec != CODEC_RICE && codec != CODEC_ADPCM)
+        codec = CODEC_RAW;
+    if (codec == CODEC_RAW || bw.len >= n - 1)
+    {
+        codec = CODEC_RAW;
+        param = 0;
+        bw.len = (n > 1) ? n - 1 : 0;
+        memcpy(bw.out, in + 1, bw.len);
+    }
+
+    out[0] = codec;
+    out[1] = n;
+    out[2] = n >> 8;
+    out[3] = param;
+    out[4] = in[0];
+    out[5] = bw.len;
+    out[6] = bw.len >> 8;
+    return CODEC_HDR_SIZE + bw.len;
+}
+
+int codec_decode( const uint8_t* in, unsigned len, uint8_t* out, unsigned max )
+{
+    if (len < CODEC_HDR_SIZE)
+        return -1;
+
+    const uint8_t  codec = in[0];
+    const unsigned n     = in[1] | (in[2] << 8);
+    const unsigned param = in[3];
+    const unsigned data  = in[5] | (in[6] << 8);
+    if (n == 0 || n > max || CODEC_HDR_SIZE + data > len)
+        return -1;
+
+    bit_reader br = { in + CODEC_HDR_SIZE, data, 0, 0, 0 };
+    out[0] = in[4];
+
+    if (codec == CODEC_RAW)
+    {
+        if (data != n - 1)
+            return -1;
+        memcpy(out + 1, br.in, data);
+    }
+    else if (codec == CODEC_RICE)
+    {
+        if (param > RICE_K_MAX)
+            return -1;
+        for (unsigned i = 1; i < n; ++i)
+        {
+            unsigned q = 0;
+            int bit = 0;
+            while (q < RICE_ESCAPE && (bit = s__get_bits(&br, 1)) == 1)
+                q++;
+            if (bit < 0)
+                return -1;
+
+            int u;
+            if (q < RICE_ESCAPE)
+            {
+                int r = s__get_bits(&br, param);
+                if (r < 0)
+                    return -1;
+                u = (q << param) | r;
+            }
+            else
+            {
+                u = s__get_bits(&br, 8);
+                if (u < 0)
+                    return -1;
+            }
+            out[i] = s__unzigzag(u, out[i-1]);
+        }
+    }
+    else if (codec == CODEC_ADPCM)
+    {
+        if (param > 88)
+            return -1;
+        int pred  = (out[0] - 128) << 8;
+        int index = param;
+        for (unsigned i = 1; i < n; ++i)
+        {
+            int code = s__get_bits(&br, 4);
+            if (code < 0)
+                return -1;
+            s__adpcm_step_update(&pred, &index, code);
+            out[i] = s__adpcm_sample(pred);
+        }
+    }
+    else
+    {
+        return -1;
+    }
+
+    return n;
+}
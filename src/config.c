@@ -6,15 +6,49 @@
 #include "messages.h"
 
 
+/// Tamano del archivo de configuracion en bytes.
+#define CONFIG_FILE_SIZE    5
+
+
 static FATFS    s__fatfs;
 static FIL      s__fp;
 
 
+static void s__put_u32( uint8_t* p, uint32_t v )
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static uint32_t s__get_u32( const uint8_t* p )
+{
+    return p[0] | (p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+/**
+ * Carga los campos presentes en los 'n' bytes leidos del archivo, los que
+ * falten quedan por defecto.
+ */
+void s__parse_config( const uint8_t* data, unsigned n, config_data* cfg )
+{
+    config_default(cfg);
+    if (n >= 1)
+        cfg->sample_period = data[0];
+    if (n >= 5)
+        cfg->sample_period_us = s__get_u32(&data[1]);
+}
+
 int s__write_config( FIL* fp, const config_data* cfg )
 {
     int ret = 0;
     UINT bw;
-    FRESULT fr = f_write(&s__fp, &cfg->sample_period, 1, &bw);
+    uint8_t data[CONFIG_FILE_SIZE];
+    data[0] = cfg->sample_period;
+    s__put_u32(&data[1], cfg->sample_period_us);
+
+    FRESULT fr = f_write(&s__fp, data, CONFIG_FILE_SIZE, &bw);
     if (fr != FR_OK)
     {
         // ERROR
@@ -23,7 +57,7 @@ int s__write_config( FIL* fp, const config_data* cfg )
     }
     else
     {
-        if (bw != 1)
+        if (bw != CONFIG_FILE_SIZE)
         {
             // ERROR, no pudo escribir el byte
             messages_print("ERROR: f_write &bw\n\r");
@@ -34,6 +68,12 @@ int s__write_config( FIL* fp, const config_data* cfg )
 }
 
 
+void config_default( config_data* cfg )
+{
+    cfg->sample_period    = CONFIG_DEFAULT_SAMPLE_PERIOD;
+    cfg->sample_period_us = CONFIG_DEFAULT_SAMPLE_PERIOD_US;
+}
+
 int config_init( const char* filename, config_data* cfg )
 {
     int ret = -1;
@@ -58,7 +98,7 @@ int config_init( const char* filename, config_data* cfg )
             {
                 // Config por defecto.
                 config_data def_cfg;
-                def_cfg.sample_period = CONFIG_DEFAULT_SAMPLE_PERIOD;
+                config_default(&def_cfg);
 
                 s__write_config(&s__fp, &def_cfg);
                 f_close(&s__fp);
@@ -68,7 +108,8 @@ int config_init( const char* filename, config_data* cfg )
             if (fr == FR_OK)
             {
                 UINT bw;
-                fr = f_read(&s__fp, &cfg->sample_period, 1, &bw);
+                uint8_t data[CONFIG_FILE_SIZE];
+                fr = f_read(&s__fp, data, CONFIG_FILE_SIZE, &bw);
                 if (fr != FR_OK)
                 {
                     // ERROR
@@ -76,9 +117,9 @@ int config_init( const char* filename, config_data* cfg )
                 }
                 else
                 {
-                    if (bw != 1)
+                    if (bw < 1)
                     {
-                        // ERROR, no pudo leer el byte
+                        // ERROR, no pudo leer ni el primer byte
                         messages_print("ERROR: f_read &bw\n\r");
                     }
                     else
@@ -87,6 +128,7 @@ int config_init( const char* filename, config_data* cfg )
                         // Se creo el archivo nuevo si no existia y se escribio
                         // la config por defecto.
                         // Se leyo el archivo de configuracion.
+                        s__parse_config(data, bw, cfg);
                         messages_print("CONFIG: FS is UP\n\r");
                         ret = 0;
                     }
@@ -125,3 +167,20 @@ int config_write( const char* filename, const config_data* cfg )
     }
     return ret;
 }
+
+int config_read_file( const char* filename, uint8_t* data, unsigned max )
+{
+    int ret = -1;
+    FRESULT fr = f_open(&s__fp, filename, FA_READ);
+    if (fr == FR_OK)
+    {
+        UINT br;
+        fr = f_read(&s__fp, data, max, &br);
+        if (fr == FR_OK)
+            ret = br;
+        else
+            messages_print("ERROR: config_read_file f_read\n\r");
+        f_close(&s__fp);
+    }
+    return ret;
+}
@@ -0,0 +1,160 @@
+#include "events.h"
+
+
+static void s__emit( event_record* out, unsigned* n_out, uint8_t type,
+                     uint32_t index, uint8_t value, uint32_t length )
+{
+    event_record* rec = &out[(*n_out)++];
+    rec->index  = index;
+    rec->type   = type;
+    rec->value  = value;
+    rec->length = (length > 0xFFFF) ? 0xFFFF : length;
+}
+
+static void s__peak( events_type* ev, uint8_t x, event_record* out, unsigned* n_out )
+{
+    if (!ev->peak_valid)
+    {
+        ev->peak_valid = true;
+        ev->seek_max   = true;
+        ev->peak       = x;
+        ev->peak_index = ev->index;
+        return;
+    }
+
+    // Mientras se acerca al extremo lo sigue, cuando se aleja 'prominence'
+    // el extremo queda confirmado y se busca el opuesto desde aca.
+    if (ev->seek_max)
+    {
+        if (x > ev->peak)
+        {
+            ev->peak       = x;
+            ev->peak_index = ev->index;
+        }
+        else if (ev->peak - x >= ev->prominence)
+        {
+            s__emit(out, n_out, EVENT_MAX, ev->peak_index, ev->peak, 0);
+            ev->seek_max   = false;
+            ev->peak       = x;
+            ev->peak_index = ev->index;
+        }
+    }
+    else
+    {
+        if (x < ev->peak)
+        {
+            ev->peak       = x;
+            ev->peak_index = ev->index;
+        }
+        else if (x - ev->peak >= ev->prominence)
+        {
+            s__emit(out, n_out, EVENT_MIN, ev->peak_index, ev->peak, 0);
+            ev->seek_max   = true;
+            ev->peak       = x;
+            ev->peak_index = ev->index;
+        }
+    }
+}
+
+static void s__cross( events_type* ev, uint8_t x, event_record* out, unsigned* n_out )
+{
+    const int up   = (int) ev->level + ev->hyst;
+    const int down = (int) ev->level - ev->hyst;
+
+    if (x >= up && ev->side <= 0)
+    {
+        if (ev->side < 0)
+            s__emit(out, n_out, EVENT_CROSS_UP, ev->index, x, 0);
+        ev->side = 1;
+    }
+    else if (x <= down && ev->side >= 0)
+    {
+        if (ev->side > 0)
+            s__emit(out, n_out, EVENT_CROSS_DOWN, ev->index, x, 0);
+        ev->side = -1;
+    }
+}
+
+static void s__run( events_type* ev, uint8_t x, event_record* out, unsigned* n_out )
+{
+    const int8_t now = (x > ev->hi) ? 1 : (x < ev->lo) ? -1 : 0;
+
+    if (ev->run != 0 && now == ev->run)
+    {
+        if ((now > 0 && x > ev->run_value) || (now < 0 && x < ev->run_value))
+            ev->run_value = x;
+        return;
+    }
+
+    if (ev->run != 0)
+    {
+        const uint32_t length = ev->index - ev->run_index;
+        if (length >= ev->min_run)
+            s__emit(out, n_out, (ev->run > 0) ? EVENT_RUN_HIGH : EVENT_RUN_LOW,
+                    ev->run_index, ev->run_value, length);
+    }
+
+    ev->run       = now;
+    ev->run_value = x;
+    ev->run_index = ev->index;
+}
+
+
+int events_init( events_type* ev, uint8_t prominence, uint8_t level, uint8_t hyst,
+                 uint8_t lo, uint8_t hi, uint16_t min_run )
+{
+    ev->prominence = prominence;
+    ev->level      = level;
+    ev->hyst       = hyst;
+    ev->lo         = lo;
+    ev->hi         = hi;
+    ev->min_run    = min_run;
+    ev->index      = 0;
+    ev->peak_valid = false;
+    ev->seek_max   = true;
+    ev->peak       = 0;
+    ev->peak_index = 0;
+    ev->side       = 0;
+    ev->run        = 0;
+    ev->run_value  = 0;
+    ev->run_index  = 0;
+
+    if (prominence == 0 || lo > hi || min_run == 0)
+    {
+        // Sin eventos: picos imposibles, sin niveles que cruzar ni rachas.
+        ev->prominence = 0xFF;
+        ev->hyst       = 0xFF;
+        ev->lo         = 0;
+        ev->hi         = 0xFF;
+        return -1;
+    }
+    return 0;
+}
+
+unsigned events_push( events_type* ev, const uint8_t* samples, unsigned n,
+                      event_record* out, unsigned max, unsigned* n_out )
+{
+    *n_out = 0;
+    unsigned i = 0;
+    for (; i < n && max - *n_out >= EVENTS_PER_SAMPLE; ++i)
+    {
+        const uint8_t x = samples[i];
+        s__peak(ev, x, out, n_out);
+        s__cross(ev, x, out, n_out);
+        s__run(ev, x, out, n_out);
+        ev->index++;
+    }
+    return i;
+}
+
+void events_encode( const event_record* rec, uint8_t* out )
+{
+    out[0] = rec->index;
+    out[1] = rec->index >> 8;
+    out[2] = rec->index >> 16;
+    out[3] = rec->index >> 24;
+    out[4] = rec->type;
+    out[5] = rec->value;
+    out[6] = rec->length;
+    out[7] = rec->length >> 8;
+}
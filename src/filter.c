@@ -0,0 +1,120 @@
+#include "filter.h"
+
+
+static uint8_t s__saturate( int32_t y )
+{
+    y += 128;
+    return (y < 0) ? 0 : (y > 255) ? 255 : y;
+}
+
+static void s__reset( filter_type* f )
+{
+    f->phase = 0;
+    f->idx   = 0;
+    for (unsigned i = 0; i < 2 * FILTER_FIR_MAX; ++i)
+        f->hist[i] = 0;
+    for (unsigned s = 0; s < FILTER_BIQUAD_MAX; ++s)
+        for (unsigned i = 0; i < 4; ++i)
+            f->iir[s][i] = 0;
+}
+
+static int32_t s__fir( filter_type* f, int16_t x, int compute )
+{
+    // Cada muestra se escribe dos veces, asi los n anteriores siempre estan
+    // seguidos a partir de 'idx'.
+    const unsigned n = f->n;
+    f->idx = (f->idx == 0) ? n - 1 : f->idx - 1;
+    f->hist[f->idx]     = x;
+    f->hist[f->idx + n] = x;
+    if (!compute)
+        return 0;
+
+    const int16_t* h = f->coef;
+    const int16_t* p = &f->hist[f->idx];
+    int32_t acc = 1L << 14;
+    for (unsigned k = 0; k < n; ++k)
+        acc += (int32_t) h[k] * p[k];
+    return acc >> 15;
+}
+
+static int32_t s__biquad( filter_type* f, int16_t x )
+{
+    int32_t v = (int32_t) x << 8;
+    for (unsigned s = 0; s < f->n; ++s)
+    {
+        const int16_t* c = &f->coef[5 * s];
+        int32_t* st = f->iir[s];
+        int64_t acc = (int64_t) c[0] * v + (int64_t) c[1] * st[0] + (int64_t) c[2] * st[1]
+                    - (int64_t) c[3] * st[2] - (int64_t) c[4] * st[3];
+        int32_t y = (acc + (1L << 13)) >> 14;
+
+        st[1] = st[0];
+        st[0] = v;
+        st[3] = st[2];
+        st[2] = y;
+        v = y;
+    }
+    return (v + (1L << 7)) >> 8;
+}
+
+
+void filter_init( filter_type* f )
+{
+    f->type  = FILTER_NONE;
+    f->n     = 0;
+    f->decim = 1;
+    s__reset(f);
+}
+
+int filter_parse( filter_type* f, const uint8_t* data, unsigned n )
+{
+    filter_init(f);
+    if (n < 3)
+        return -1;
+
+    const uint8_t type  = data[0];
+    const uint8_t count = data[1];
+    const uint8_t decim = data[2];
+    const unsigned n_coef = (type == FILTER_BIQUAD) ? 5U * count : count;
+
+    if (decim == 0)
+        return -1;
+    if (type == FILTER_FIR && (count == 0 || count > FILTER_FIR_MAX))
+        return -1;
+    if (type == FILTER_BIQUAD && (count == 0 || count > FILTER_BIQUAD_MAX))
+        return -1;
+    if (type > FILTER_BIQUAD || n < 3 + 2 * n_coef)
+        return -1;
+
+    for (unsigned i = 0; i < n_coef; ++i)
+        f->coef[i] = (int16_t)(data[3 + 2*i] | (data[4 + 2*i] << 8));
+    f->type  = type;
+    f->n     = (type == FILTER_NONE) ? 0 : count;
+    f->decim = decim;
+    return 0;
+}
+
+unsigned filter_apply( filter_type* f, uint8_t* buf, unsigned n )
+{
+    unsigned out = 0;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        const int16_t x = (int16_t) buf[i] - 128;
+        const int keep = (f->phase == 0);
+        if (++f->phase >= f->decim)
+            f->phase = 0;
+
+        int32_t y;
+        if (f->type == FILTER_FIR)
+            y = s__fir(f, x, keep);
+        else if (f->type == FILTER_BIQUAD)
+            y = s__biquad(f, x);
+        else
+            y = x;
+
+        // Se escribe atras de lo que ya se leyo, se puede hacer en el lugar.
+        if (keep)
+            buf[out++] = s__saturate(y);
+    }
+    return out;
+}
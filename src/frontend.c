@@ -0,0 +1,62 @@
+#include "frontend.h"
+#include "adc.h"
+
+
+/// Instancia que atiende la interrupcion del ADC.
+static frontend_type* s__frontend = NULL;
+
+
+static bool s__on_sample( uint16_t sample )
+{
+    frontend_type* fe = s__frontend;
+    uint16_t out;
+    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+
+    if (fe != NULL && cic_push(&fe->cic, sample, &out))
+    {
+        if (fe->ready)
+            fe->overruns++;
+        fe->out   = out;
+        fe->ready = true;
+        vTaskNotifyGiveFromISR(fe->task, &xHigherPriorityTaskWoken);
+    }
+    return xHigherPriorityTaskWoken == pdTRUE;
+}
+
+
+int frontend_init( frontend_type* fe, unsigned order, unsigned log2_ratio, unsigned out_bits )
+{
+    fe->task     = NULL;
+    fe->out      = 0;
+    fe->ready    = false;
+    fe->overruns = 0;
+    return cic_init(&fe->cic, order, log2_ratio, 10, out_bits);
+}
+
+void frontend_start( frontend_type* fe, int chn, uint32_t out_period_us )
+{
+    fe->task    = xTaskGetCurrentTaskHandle();
+    s__frontend = fe;
+
+    adc_set_resolution(10);
+    adc_irq_start(chn, s__on_sample);
+    adc_timer_start(chn, out_period_us >> fe->cic.log2_ratio);
+}
+
+bool frontend_read( frontend_type* fe, uint16_t* out, TickType_t xTicksToWait )
+{
+    bool ret = false;
+
+    ulTaskNotifyTake(pdTRUE, xTicksToWait);
+
+    taskENTER_CRITICAL();
+    if (fe->ready)
+    {
+        *out      = fe->out;
+        fe->ready = false;
+        ret       = true;
+    }
+    taskEXIT_CRITICAL();
+
+    return ret;
+}
@@ -0,0 +1,108 @@
+#include "goertzel.h"
+#include <math.h>
+
+
+#define GOERTZEL_PI     3.14159265358979
+
+
+static void s__reset( goertzel_type* g )
+{
+    g->n = 0;
+    for (unsigned t = 0; t < GOERTZEL_TONES_MAX; ++t)
+    {
+        g->s1[t] = 0;
+        g->s2[t] = 0;
+    }
+}
+
+static uint16_t s__amplitude( const goertzel_type* g, unsigned t )
+{
+    // |X|^2 = s1^2 + s2^2 - c*s1*s2, y la amplitud del seno es 2*|X|/N.
+    const float c  = g->coef[t] / 1073741824.0f;
+    const float s1 = g->s1[t];
+    const float s2 = g->s2[t];
+    float power = s1 * s1 + s2 * s2 - c * s1 * s2;
+    if (power < 0)
+        power = 0;
+    const float a = 2.0f * sqrtf(power) / g->n * 256.0f + 0.5f;
+    return (a > 65535.0f) ? 65535 : (uint16_t) a;
+}
+
+
+int goertzel_init( goertzel_type* g, unsigned size )
+{
+    g->tones.n = 0;
+    if (size == 0 || size > GOERTZEL_SIZE_MAX)
+    {
+        g->size = 1;
+        s__reset(g);
+        return -1;
+    }
+
+    g->size = size;
+    s__reset(g);
+    return 0;
+}
+
+int goertzel_parse( goertzel_tones* t, const uint8_t* data, unsigned n )
+{
+    t->n = 0;
+    if (n < 1 || data[0] == 0 || data[0] > GOERTZEL_TONES_MAX || n < 1 + 4U * data[0])
+        return -1;
+
+    for (unsigned i = 0; i < data[0]; ++i)
+    {
+        const uint8_t* p = &data[1 + 4 * i];
+        t->freq_mhz[i] = p[0] | (p[1] << 8) | ((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+    }
+    t->n = data[0];
+    return t->n;
+}
+
+void goertzel_set_tones( goertzel_type* g, const goertzel_tones* t, uint32_t period_us )
+{
+    g->tones = *t;
+    for (unsigned i = 0; i < t->n; ++i)
+    {
+        // w = 2*pi*f*Ts, con f en mHz y Ts en us.
+        const double w = 2 * GOERTZEL_PI * t->freq_mhz[i] * 1e-3 * period_us * 1e-6;
+        const double c = 2 * cos(w) * 1073741824.0;
+        g->coef[i] = (c >= 2147483647.0) ? 2147483647 : (int32_t) lround(c);
+    }
+    s__reset(g);
+}
+
+unsigned goertzel_push( goertzel_type* g, const uint8_t* samples, unsigned n,
+                        uint16_t* out, bool* done )
+{
+    unsigned used = g->size - g->n;
+    if (used > n)
+        used = n;
+
+    // Un tono por vez, asi el estado y el coeficiente quedan en registros.
+    for (unsigned t = 0; t < g->tones.n; ++t)
+    {
+        const int32_t c = g->coef[t];
+        int32_t s1 = g->s1[t];
+        int32_t s2 = g->s2[t];
+        for (unsigned i = 0; i < used; ++i)
+        {
+            const int32_t s0 = ((int32_t) samples[i] - 128)
+                             + (int32_t)(((int64_t) c * s1) >> 30) - s2;
+            s2 = s1;
+            s1 = s0;
+        }
+        g->s1[t] = s1;
+        g->s2[t] = s2;
+    }
+    g->n += used;
+
+    *done = (g->n == g->size);
+    if (*done)
+    {
+        for (unsigned t = 0; t < g->tones.n; ++t)
+            out[t] = s__amplitude(g, t);
+        s__reset(g);
+    }
+    return used;
+}
@@ -0,0 +1,105 @@
+#include "governor.h"
+
+
+static unsigned s__decide( governor_type* gov, unsigned period, unsigned reason,
+                           unsigned occupancy_pct, uint32_t latency_ms, uint32_t now_ms )
+{
+    unsigned next = period;
+    if (reason == GOVERNOR_IDLE)
+    {
+        if (period > gov->min)
+            next = period - 1;
+    }
+    else if (period < gov->max)
+    {
+        next = period + 1;
+    }
+
+    // Despues de un cambio hay que volver a juntar evidencia.
+    gov->n_up   = 0;
+    gov->n_down = 0;
+
+    if (next != period)
+    {
+        governor_decision* d = &gov->log[gov->log_next];
+        d->time_ms    = now_ms;
+        d->latency_ms = latency_ms;
+        d->occupancy  = occupancy_pct;
+        d->reason     = reason;
+        d->from       = period;
+        d->to         = next;
+        gov->log_next = (gov->log_next + 1) % GOVERNOR_LOG_SIZE;
+        gov->log_count++;
+    }
+    return next;
+}
+
+
+void governor_init( governor_type* gov, unsigned min, unsigned max,
+                    unsigned hi_pct, unsigned lo_pct, uint32_t latency_max_ms,
+                    unsigned hold_up, unsigned hold_down )
+{
+    gov->min         = min;
+    gov->max         = max;
+    gov->hi_pct      = hi_pct;
+    gov->lo_pct      = lo_pct;
+    gov->latency_max = latency_max_ms;
+    gov->hold_up     = hold_up;
+    gov->hold_down   = hold_down;
+    gov->n_up        = 0;
+    gov->n_down      = 0;
+    gov->log_next    = 0;
+    gov->log_count   = 0;
+}
+
+unsigned governor_update( governor_type* gov, unsigned period, unsigned occupancy_pct,
+                          uint32_t latency_ms, bool overrun, uint32_t now_ms )
+{
+    if (overrun)
+        return s__decide(gov, period, GOVERNOR_OVERRUN, occupancy_pct, latency_ms, now_ms);
+
+    const bool backlog = occupancy_pct >= gov->hi_pct;
+    const bool slow    = latency_ms > gov->latency_max;
+    if (backlog || slow)
+    {
+        gov->n_down = 0;
+        if (++gov->n_up >= gov->hold_up)
+        {
+            unsigned reason = backlog ? GOVERNOR_BACKLOG : GOVERNOR_LATENCY;
+            return s__decide(gov, period, reason, occupancy_pct, latency_ms, now_ms);
+        }
+    }
+    else if (occupancy_pct <= gov->lo_pct)
+    {
+        gov->n_up = 0;
+        if (++gov->n_down >= gov->hold_down)
+            return s__decide(gov, period, GOVERNOR_IDLE, occupancy_pct, latency_ms, now_ms);
+    }
+    else
+    {
+        // Banda muerta.
+        gov->n_up   = 0;
+        gov->n_down = 0;
+    }
+    return period;
+}
+
+bool governor_last( const governor_type* gov, governor_decision* out )
+{
+    if (gov->log_count == 0)
+        return false;
+    *out = gov->log[(gov->log_next + GOVERNOR_LOG_SIZE - 1) % GOVERNOR_LOG_SIZE];
+    return true;
+}
+
+unsigned governor_log( const governor_type* gov, governor_decision* out, unsigned max )
+{
+    unsigned n = (gov->log_count < GOVERNOR_LOG_SIZE) ? gov->log_count : GOVERNOR_LOG_SIZE;
+    if (n > max)
+        n = max;
+
+    unsigned first = (gov->log_next + GOVERNOR_LOG_SIZE - n) % GOVERNOR_LOG_SIZE;
+    for (unsigned i = 0; i < n; ++i)
+        out[i] = gov->log[(first + i) % GOVERNOR_LOG_SIZE];
+    return n;
+}
@@ -0,0 +1,144 @@
+#include "index_ring.h"
+#include <task.h>
+
+
+#define s__load(p)          __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define s__store(p, v)      __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define s__cas(p, e, v)     __atomic_compare_exchange_n((p), (e), (v), false, \
+                                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)
+
+
+static int s__try_pop( index_ring* r )
+{
+    uint32_t pos = s__load(&r->head);
+    while (1)
+    {
+        // El lugar esta escrito cuando su secuencia es pos + 1.
+        const uint32_t seq  = s__load(&r->seq[pos & r->mask]);
+        const int32_t  diff = (int32_t)(seq - (pos + 1));
+        if (diff < 0)
+            return -1;
+        if (diff > 0)
+        {
+            // Otro consumidor se lo llevo, probamos con el siguiente.
+            pos = s__load(&r->head);
+            continue;
+        }
+        if (s__cas(&r->head, &pos, pos + 1))
+            break;
+    }
+
+    const uint8_t idx = r->idx[pos & r->mask];
+    // Libre para la proxima vuelta del productor.
+    s__store(&r->seq[pos & r->mask], pos + r->mask + 1);
+    return idx;
+}
+
+static bool s__try_push( index_ring* r, uint8_t idx )
+{
+    uint32_t pos = s__load(&r->tail);
+    while (1)
+    {
+        // El lugar esta libre cuando su secuencia es pos.
+        const uint32_t seq  = s__load(&r->seq[pos & r->mask]);
+        const int32_t  diff = (int32_t)(seq - pos);
+        if (diff < 0)
+            return false;
+        if (diff > 0)
+        {
+            pos = s__load(&r->tail);
+            continue;
+        }
+        if (s__cas(&r->tail, &pos, pos + 1))
+            break;
+    }
+
+    r->idx[pos & r->mask] = idx;
+    s__store(&r->seq[pos & r->mask], pos + 1);
+    return true;
+}
+
+static bool s__waiting( index_ring* r )
+{
+    // Se mira 'waiting' despues de publicar, y el consumidor lo escribe antes
+    // de volver a mirar el anillo, asi no se pierde el aviso.
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    return r->waiting != 0;
+}
+
+
+int index_ring_init( index_ring* r, unsigned n )
+{
+    if (n > INDEX_RING_MAX)
+        return -1;
+
+    unsigned size = 1;
+    while (size < n)
+        size <<= 1;
+
+    r->head   = 0;
+    r->tail   = 0;
+    r->mask   = size - 1;
+    r->waiting = 0;
+    r->wake    = xSemaphoreCreateBinaryStatic(&r->wake_static);
+    for (unsigned i = 0; i < size; ++i)
+        r->seq[i] = i;
+    return 0;
+}
+
+bool index_ring_push( index_ring* r, uint8_t idx )
+{
+    if (!s__try_push(r, idx))
+        return false;
+
+    if (s__waiting(r))
+        xSemaphoreGive(r->wake);
+    return true;
+}
+
+bool index_ring_push_from_isr( index_ring* r, uint8_t idx, BaseType_t* pxHigherPriorityTaskWoken )
+{
+    if (!s__try_push(r, idx))
+        return false;
+
+    if (s__waiting(r))
+        xSemaphoreGiveFromISR(r->wake, pxHigherPriorityTaskWoken);
+    return true;
+}
+
+int index_ring_pop( index_ring* r, TickType_t xTicksToWait )
+{
+    int idx = s__try_pop(r);
+    if (idx >= 0 || xTicksToWait == 0)
+        return idx;
+
+    const TickType_t start = xTaskGetTickCount();
+    while (1)
+    {
+        r->waiting = 1;
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+        idx = s__try_pop(r);
+        if (idx >= 0)
+            break;
+
+        TickType_t wait = portMAX_DELAY;
+        if (xTicksToWait != portMAX_DELAY)
+        {
+            const TickType_t elapsed = xTaskGetTickCount() - start;
+            if (elapsed >= xTicksToWait)
+                break;
+            wait = xTicksToWait - elapsed;
+        }
+        // Un aviso viejo solo hace que se vuelva a mirar el anillo.
+        xSemaphoreTake(r->wake, wait);
+    }
+
+    r->waiting = 0;
+    return idx;
+}
+
+unsigned index_ring_count( const index_ring* r )
+{
+    return s__load(&r->tail) - s__load(&r->head);
+}
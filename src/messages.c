@@ -10,6 +10,12 @@
 char          s__buffer[MESSAGES_QUEUE_SIZE];
 QueueHandle_t s__queueMessages;
 
+// Memoria de la cola y de la tarea, estatica para no usar el heap.
+static uint8_t       s__queueMem[MESSAGES_QUEUE_NMBR * MESSAGES_QUEUE_SIZE];
+static StaticQueue_t s__queueStatic;
+static StackType_t   s__taskStack[configMINIMAL_STACK_SIZE*2];
+static StaticTask_t  s__taskTcb;
+
 void vTaskMessages( void *pParam )
 {
     while (1)
@@ -29,17 +35,47 @@ void vTaskMessages( void *pParam )
 
 void messages_init( int priority )
 {
-    s__queueMessages = xQueueCreate(MESSAGES_QUEUE_NMBR, MESSAGES_QUEUE_SIZE);
-
-    xTaskCreate( vTaskMessages,
-                 (const char*) "Task Messages",
-                 configMINIMAL_STACK_SIZE*2,
-                 NULL,
-                 priority,
-                 NULL );
+    s__queueMessages = xQueueCreateStatic(MESSAGES_QUEUE_NMBR, MESSAGES_QUEUE_SIZE,
+                                          s__queueMem, &s__queueStatic);
+
+    xTaskCreateStatic( vTaskMessages,
+                       (const char*) "Task Messages",
+                       configMINIMAL_STACK_SIZE*2,
+                       NULL,
+                       priority,
+                       s__taskStack,
+                       &s__taskTcb );
 }
 
 void messages_print( const char* msg )
 {
     xQueueSendToBack(s__queueMessages, msg, 0);
 }
+
+void messages_print_int( const char* prefix, long value, const char* suffix )
+{
+    char msg[MESSAGES_QUEUE_SIZE];
+    char digits[12];
+    unsigned n = 0;
+    unsigned nd = 0;
+
+    unsigned long v = (value < 0) ? -(unsigned long) value : (unsigned long) value;
+    do
+    {
+        digits[nd++] = '0' + v % 10;
+        v /= 10;
+    }
+    while (v != 0);
+
+    for (; *prefix != '\0' && n < MESSAGES_QUEUE_SIZE-1; ++prefix)
+        msg[n++] = *prefix;
+    if (value < 0 && n < MESSAGES_QUEUE_SIZE-1)
+        msg[n++] = '-';
+    while (nd > 0 && n < MESSAGES_QUEUE_SIZE-1)
+        msg[n++] = digits[--nd];
+    for (; *suffix != '\0' && n < MESSAGES_QUEUE_SIZE-1; ++suffix)
+        msg[n++] = *suffix;
+    msg[n] = '\0';
+
+    messages_print(msg);
+}
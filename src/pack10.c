@@ -0,0 +1,32 @@
+#include "pack10.h"
+
+
+void pack10_encode( const uint16_t* in, unsigned n, uint8_t* out )
+{
+    for (unsigned i = 0; i < n; i += PACK10_GROUP)
+    {
+        uint8_t low = 0;
+        for (unsigned j = 0; j < PACK10_GROUP; ++j)
+        {
+            out[j] = (in[j] >> 2) & 0xFF;
+            low   |= (in[j] & 0x03) << (2*j);
+        }
+        out[PACK10_GROUP] = low;
+
+        in  += PACK10_GROUP;
+        out += PACK10_BYTES;
+    }
+}
+
+void pack10_decode( const uint8_t* in, unsigned n, uint16_t* out )
+{
+    for (unsigned i = 0; i < n; i += PACK10_GROUP)
+    {
+        const uint8_t low = in[PACK10_GROUP];
+        for (unsigned j = 0; j < PACK10_GROUP; ++j)
+            out[j] = (in[j] << 2) | ((low >> (2*j)) & 0x03);
+
+        in  += PACK10_BYTES;
+        out += PACK10_GROUP;
+    }
+}
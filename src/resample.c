@@ -0,0 +1,187 @@
+#include "resample.h"
+#include <math.h>
+
+
+#define RESAMPLE_PI     3.14159265f
+
+
+static uint8_t s__saturate( int32_t y )
+{
+    y += 128;
+    return (y < 0) ? 0 : (y > 255) ? 255 : y;
+}
+
+static unsigned s__gcd( unsigned a, unsigned b )
+{
+    while (b != 0)
+    {
+        const unsigned t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/**
+ * Primer muestra de la linea de retardo que usa un filtro de 'taps'
+ * coeficientes por fase, para que quede centrado en RESAMPLE_DELAY.
+ */
+static unsigned s__first( unsigned taps )
+{
+    return RESAMPLE_DELAY - taps / 2;
+}
+
+/**
+ * Calcula los coeficientes para up/down.  El prototipo tiene taps * up
+ * coeficientes a la tasa intermedia, h[k * up + p] va a coef[p * taps + k], y
+ * esta centrado en RESAMPLE_DELAY muestras de entrada sea cual sea la
+ * relacion.
+ */
+static void s__design( resample_type* r, unsigned up, unsigned down )
+{
+    // Mas coeficientes cuanto mas se baja la tasa, para que el corte no se
+    // ensanche.  Siempre pares, para quedar centrados en RESAMPLE_DELAY.
+    unsigned taps = RESAMPLE_TAPS_PER_OUT * ((down + up - 1) / up);
+    if (taps > RESAMPLE_TAPS_MAX)
+        taps = RESAMPLE_TAPS_MAX;
+
+    const float half = taps * up / 2.0f;
+    const float fc = 0.5f / down;  // Ciclos por muestra de la tasa intermedia
+
+    for (unsigned p = 0; p < up; ++p)
+    {
+        float h[RESAMPLE_TAPS_MAX];
+        float sum = 0;
+        for (unsigned k = 0; k < taps; ++k)
+        {
+            // Distancia al centro en muestras de la tasa intermedia.
+            const float t = ((float) k - taps / 2) * up + p;
+            const float x = 2 * RESAMPLE_PI * fc * t;
+            const float sinc = (t == 0) ? 1.0f : sinf(x) / x;
+            const float win = 0.5f + 0.5f * cosf(RESAMPLE_PI * t / half);
+            h[k] = sinc * win;
+            sum += h[k];
+        }
+
+        // Ganancia 1 en continua en cada fase, el error de redondeo va al
+        // coeficiente mas grande.
+        int16_t* c = &r->coef[p * taps];
+        int32_t total = 0;
+        unsigned big = 0;
+        for (unsigned k = 0; k < taps; ++k)
+        {
+            float q = h[k] / sum * 32768.0f;
+            q = (q > 32767.0f) ? 32767.0f : (q < -32768.0f) ? -32768.0f : q;
+            c[k] = (int16_t) lrintf(q);
+            total += c[k];
+            if (h[k] > h[big])
+                big = k;
+        }
+        const int32_t fixed = c[big] + 32768 - total;
+        c[big] = (fixed > 32767) ? 32767 : (fixed < -32768) ? -32768 : fixed;
+    }
+
+    // La proxima salida queda en el mismo instante con la nueva resolucion,
+    // el retardo no cambia.
+    if (r->up == r->down)
+        r->phase = 0;
+    else
+        r->phase = (r->phase * up + r->up / 2) / r->up;
+
+    r->taps = taps;
+    r->up   = up;
+    r->down = down;
+}
+
+static int32_t s__output( const resample_type* r, unsigned phase )
+{
+    const int16_t* c = &r->coef[phase * r->taps];
+    const int16_t* x = &r->hist[r->idx + s__first(r->taps)];
+    int32_t acc = 1L << 14;
+    for (unsigned k = 0; k < r->taps; ++k)
+        acc += (int32_t) c[k] * x[k];
+    return acc >> 15;
+}
+
+
+void resample_init( resample_type* r )
+{
+    r->request = (1 << 8) | 1;
+    r->up      = 1;
+    r->down    = 1;
+    r->taps    = 0;
+    r->phase   = 0;
+    r->idx     = 0;
+    for (unsigned i = 0; i < 2 * RESAMPLE_TAPS_MAX; ++i)
+        r->hist[i] = 0;
+}
+
+int resample_set_ratio( resample_type* r, unsigned up, unsigned down )
+{
+    if (up == 0 || down == 0)
+        return -1;
+
+    const unsigned g = s__gcd(up, down);
+    up   /= g;
+    down /= g;
+    if (up > down || up > RESAMPLE_UP_MAX || down > RESAMPLE_DOWN_MAX)
+        return -1;
+
+    // Una sola escritura de 16 bits, la lee la otra tarea sin bloquear.
+    r->request = (up << 8) | down;
+    return 0;
+}
+
+void resample_sync( resample_type* r )
+{
+    const uint16_t request = r->request;
+    const unsigned up   = request >> 8;
+    const unsigned down = request & 0xFF;
+    if (up == r->up && down == r->down)
+        return;
+
+    if (up == down)
+    {
+        r->up    = up;
+        r->down  = down;
+        r->phase = 0;
+    }
+    else
+    {
+        s__design(r, up, down);
+    }
+}
+
+unsigned resample_apply( resample_type* r, uint8_t* buf, unsigned n )
+{
+    resample_sync(r);
+
+    unsigned out = 0;
+    for (unsigned i = 0; i < n; ++i)
+    {
+        // La linea de retardo se actualiza siempre, aunque no se remuestree,
+        // para que un cambio de relacion arranque con la historia completa.
+        const int16_t x = (int16_t) buf[i] - 128;
+        r->idx = (r->idx == 0) ? RESAMPLE_TAPS_MAX - 1 : r->idx - 1;
+        r->hist[r->idx]                     = x;
+        r->hist[r->idx + RESAMPLE_TAPS_MAX] = x;
+
+        // Sin remuestreo sale la muestra con el mismo retardo que el filtro,
+        // asi el cambio de relacion no salta en el tiempo.
+        if (r->up == r->down)
+        {
+            buf[out++] = s__saturate(r->hist[r->idx + RESAMPLE_DELAY]);
+            continue;
+        }
+
+        // Con up <= down sale a lo sumo una muestra por cada una que entra,
+        // se escribe atras de lo que ya se leyo.
+        if (r->phase < r->up)
+        {
+            buf[out++] = s__saturate(s__output(r, r->phase));
+            r->phase += r->down;
+        }
+        r->phase -= r->up;
+    }
+    return out;
+}
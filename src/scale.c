@@ -0,0 +1,61 @@
+#include "scale.h"
+#include <string.h>
+
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+#include <chip.h>
+#define SCALE_SIMD      1
+#else
+#define SCALE_SIMD      0
+#endif
+
+
+scale_gain scale_gain_from_float( float gain )
+{
+    scale_gain g;
+    const float mag = (gain < 0) ? -gain : gain;
+
+    g.shift = 0;
+    while (g.shift < SCALE_MAX_SHIFT && mag >= (float)(1U << g.shift))
+        g.shift++;
+
+    float q = gain * (float)(1UL << (15 - g.shift));
+    g.q15 = (q >= 32767.0f) ? 32767 : (q <= -32768.0f) ? -32768 : (int16_t) q;
+    return g;
+}
+
+void scale_apply( const uint8_t* in, uint8_t* out, unsigned n, scale_gain gain )
+{
+    const unsigned rshift = 15 - gain.shift;
+    unsigned i = 0;
+
+#if SCALE_SIMD
+    // Muestras pares e impares en dos palabras de 2 x 16 bits, el producto
+    // desplazado entra en 16 bits con signo y __USAT16 satura las dos a la vez.
+    // La ganancia va solo en la mitad baja, asi __SMUAD da el producto de la
+    // muestra baja y __SMUADX el de la alta.
+    const uint32_t g = (uint16_t) gain.q15;
+    for (; i + 4 <= n; i += 4)
+    {
+        uint32_t x;
+        memcpy(&x, &in[i], sizeof(x));
+
+        const uint32_t even = __UXTB16(x);
+        const uint32_t odd  = __UXTB16(__ROR(x, 8));
+        const int32_t p0 = (int32_t) __SMUAD (even, g) >> rshift;
+        const int32_t p2 = (int32_t) __SMUADX(even, g) >> rshift;
+        const int32_t p1 = (int32_t) __SMUAD (odd,  g) >> rshift;
+        const int32_t p3 = (int32_t) __SMUADX(odd,  g) >> rshift;
+
+        const uint32_t lo = __USAT16(__PKHBT(p0, p2, 16), 8);
+        const uint32_t hi = __USAT16(__PKHBT(p1, p3, 16), 8);
+        x = lo | (hi << 8);
+        memcpy(&out[i], &x, sizeof(x));
+    }
+#endif
+
+    for (; i < n; ++i)
+    {
+        const int32_t v = ((int32_t) in[i] * gain.q15) >> rshift;
+        out[i] = (v < 0) ? 0 : (v > 255) ? 255 : v;
+    }
+}
@@ -0,0 +1,66 @@
+#include "spectrum.h"
+
+// Solo con CMSIS-DSP, ver spectrum.h.
+#if SPECTRUM_USED
+
+int spectrum_init( spectrum_type* sp, unsigned size, unsigned averages )
+{
+    if (size < 32 || size > SPECTRUM_MAX_SIZE || (size & (size - 1)) != 0 || averages == 0)
+        return -1;
+    if (arm_rfft_fast_init_f32(&sp->rfft, size) != ARM_MATH_SUCCESS)
+        return -1;
+
+    sp->size     = size;
+    sp->averages = averages;
+    sp->n        = 0;
+    sp->n_avg    = 0;
+
+    // Hann periodica, la que conviene para analisis espectral.
+    for (unsigned i = 0; i < size; ++i)
+        sp->window[i] = 0.5f - 0.5f * arm_cos_f32(2.0f * PI * i / size);
+    arm_fill_f32(0.0f, sp->acc, size / 2);
+    return 0;
+}
+
+bool spectrum_push( spectrum_type* sp, uint8_t sample )
+{
+    sp->in[sp->n++] = sample;
+    if (sp->n < sp->size)
+        return false;
+    sp->n = 0;
+
+    const unsigned half = sp->size / 2;
+
+    // La FFT usa 'in' como espacio de trabajo, asi que se puede pisar.
+    arm_mult_f32(sp->in, sp->window, sp->in, sp->size);
+    arm_rfft_fast_f32(&sp->rfft, sp->in, sp->out, 0);
+
+    // out[1] es la parte real del bin de fs/2, no la imaginaria del bin 0.
+    const float32_t dc = sp->out[0];
+    sp->out[1] = 0.0f;
+    arm_cmplx_mag_f32(sp->out, sp->in, half);
+    sp->in[0] = (dc < 0) ? -dc : dc;
+    arm_add_f32(sp->acc, sp->in, sp->acc, half);
+
+    return ++sp->n_avg == sp->averages;
+}
+
+unsigned spectrum_bins( spectrum_type* sp, uint16_t* out )
+{
+    const unsigned half = sp->size / 2;
+
+    // Con Hann la amplitud A de un seno da |X| = A * size / 4, y se pasa a
+    // 8.8 con el promedio incluido.
+    const float32_t scale = 4.0f * 256.0f / (sp->size * sp->n_avg);
+    for (unsigned k = 0; k < half; ++k)
+    {
+        float32_t v = sp->acc[k] * scale + 0.5f;
+        out[k] = (v > 65535.0f) ? 65535 : (uint16_t) v;
+    }
+
+    arm_fill_f32(0.0f, sp->acc, half);
+    sp->n_avg = 0;
+    return half;
+}
+
+#endif
@@ -0,0 +1,121 @@
+#include "summary.h"
+#include <string.h>
+#include <math.h>
+
+#if defined(__ARM_FEATURE_DSP) && __ARM_FEATURE_DSP
+#include <chip.h>
+#define SUMMARY_SIMD    1
+#else
+#define SUMMARY_SIMD    0
+#endif
+
+
+/// Muestras por llamada a s__accumulate, para que los cuadrados entren en 32 bits.
+#define SUMMARY_CHUNK   4096
+
+
+static void s__reset( summary_type* sm )
+{
+    sm->n      = 0;
+    sm->min    = 0xFF;
+    sm->max    = 0;
+    sm->sum    = 0;
+    sm->sum_sq = 0;
+}
+
+static void s__accumulate( summary_type* sm, const uint8_t* p, unsigned n )
+{
+    uint32_t sum = 0;
+    uint32_t sq  = 0;
+    unsigned i   = 0;
+
+#if SUMMARY_SIMD
+    // Cuatro muestras por palabra, minimo y maximo por byte.
+    uint32_t vmin = 0xFFFFFFFF;
+    uint32_t vmax = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        uint32_t x;
+        memcpy(&x, &p[i], sizeof(x));
+
+        sum = __USADA8(x, 0, sum);
+        uint32_t even = __UXTB16(x);
+        uint32_t odd  = __UXTB16(__ROR(x, 8));
+        sq = __SMLAD(even, even, sq);
+        sq = __SMLAD(odd, odd, sq);
+
+        __USUB8(x, vmax);
+        vmax = __SEL(x, vmax);
+        __USUB8(x, vmin);
+        vmin = __SEL(vmin, x);
+    }
+    for (unsigned b = 0; b < 32; b += 8)
+    {
+        uint8_t lo = vmin >> b;
+        uint8_t hi = vmax >> b;
+        if (lo < sm->min) sm->min = lo;
+        if (hi > sm->max) sm->max = hi;
+    }
+#endif
+
+    for (; i < n; ++i)
+    {
+        const uint8_t x = p[i];
+        sum += x;
+        sq  += (uint32_t) x * x;
+        if (x < sm->min) sm->min = x;
+        if (x > sm->max) sm->max = x;
+    }
+
+    sm->sum    += sum;
+    sm->sum_sq += sq;
+    sm->n      += n;
+}
+
+
+int summary_init( summary_type* sm, unsigned size )
+{
+    if (size == 0 || size > 0xFFFF)
+        return -1;
+
+    sm->size = size;
+    s__reset(sm);
+    return 0;
+}
+
+unsigned summary_push( summary_type* sm, const uint8_t* samples, unsigned n,
+                       summary_record* out, bool* done )
+{
+    unsigned used = sm->size - sm->n;
+    if (used > n)
+        used = n;
+
+    for (unsigned i = 0; i < used; i += SUMMARY_CHUNK)
+        s__accumulate(sm, &samples[i], (used - i < SUMMARY_CHUNK) ? used - i : SUMMARY_CHUNK);
+
+    *done = (sm->n == sm->size);
+    if (*done)
+    {
+        const float mean = (float) sm->sum / sm->n;
+        const float rms  = sqrtf((float) sm->sum_sq / sm->n);
+        out->min   = sm->min;
+        out->max   = sm->max;
+        out->mean  = mean * 256.0f + 0.5f;
+        out->rms   = rms  * 256.0f + 0.5f;
+        out->count = sm->n;
+        s__reset(sm);
+    }
+    return used;
+}
+
+void summary_encode( const summary_record* rec, uint8_t* out )
+{
+    out[0] = rec->min;
+    out[1] = rec->max;
+    out[2] = rec->mean;
+    out[3] = rec->mean >> 8;
+    out[4] = rec->rms;
+    out[5] = rec->rms >> 8;
+    out[6] = rec->count;
+    out[7] = rec->count >> 8;
+}
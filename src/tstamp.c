@@ -0,0 +1,42 @@
+#include <chip.h>
+
+#include "tstamp.h"
+
+
+void tstamp_init( void )
+{
+    Chip_TIMER_Init(LPC_TIMER1);
+    Chip_TIMER_Reset(LPC_TIMER1);
+    Chip_TIMER_PrescaleSet(LPC_TIMER1, Chip_Clock_GetRate(CLK_MX_TIMER1) / 1000000 - 1);
+    Chip_TIMER_Enable(LPC_TIMER1);
+}
+
+uint32_t tstamp_now( void )
+{
+    return Chip_TIMER_ReadCount(LPC_TIMER1);
+}
+
+void tstamp_jitter_reset( tstamp_jitter* j, uint32_t nominal_us )
+{
+    j->nominal = nominal_us;
+    j->last    = 0;
+    j->min     = 0;
+    j->max     = 0;
+    j->count   = 0;
+    j->started = false;
+}
+
+void tstamp_jitter_add( tstamp_jitter* j, uint32_t t )
+{
+    if (j->started)
+    {
+        int32_t dev = (int32_t) (t - j->last - j->nominal);
+        if (j->count == 0 || dev < j->min)
+            j->min = dev;
+        if (j->count == 0 || dev > j->max)
+            j->max = dev;
+        j->count++;
+    }
+    j->last    = t;
+    j->started = true;
+}